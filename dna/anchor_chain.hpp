@@ -0,0 +1,217 @@
+#pragma once
+
+#include "kmer_index.hpp"
+#include "sequence_buffer.hpp"
+#include "sequence_aligner.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace dna {
+
+// Start of anchor_length bases that are identical in both helixes.
+struct anchor
+{
+    int64_t helix1;
+    int64_t helix2;
+
+    bool operator==(const anchor& a) const
+    {
+        return helix1 == a.helix1 && helix2 == a.helix2;
+    }
+};
+
+// A pair of ranges, one per helix, that can be aligned independently of the rest.
+struct segment
+{
+    location helix1;
+    location helix2;
+};
+
+// Anchors are one packed word long.
+static constexpr int64_t anchor_length = word_bases;
+
+// Words of a helix sampled every `stride` bases, keyed by their packed value. This is the
+// part of anchor finding that only depends on helix 1, so a helix that is compared many times
+// only needs to be indexed once. Words that occur more than once in the sample (repeats such
+// as telomeres) are never used as anchors.
+class seed_index
+{
+    std::unordered_map<uint64_t, int64_t> sample_;
+    int64_t length_;
+
+public:
+    seed_index(const sequence_buffer<byte_span>& seq, int64_t stride) : length_(seq.size())
+    {
+        if (length_ < anchor_length)
+            return;
+
+        sample_.reserve(length_ / stride + 1);
+        for (int64_t i = 0; i + anchor_length <= length_; i += stride)
+        {
+            auto inserted = sample_.emplace(seq.word_at(i), i);
+            if (!inserted.second)
+                inserted.first->second = -1; // repeat
+        }
+    }
+
+    // Offset of the sampled word, or -1 if it was not sampled (or is a repeat).
+    int64_t find(uint64_t word) const
+    {
+        auto hit = sample_.find(word);
+        return hit == sample_.end() ? -1 : hit->second;
+    }
+
+    // Length of the indexed helix.
+    int64_t length() const
+    {
+        return length_;
+    }
+};
+
+// Finds exact matches shared by two helixes and chains them into a consistent order. Similar
+// helixes share almost every k-mer, so helix 1 only needs to be sampled every `stride` bases
+// while helix 2 is scanned at every offset to catch the shifts caused by indels.
+class anchor_finder
+{
+    int64_t stride_;
+
+public:
+    explicit anchor_finder(int64_t stride = 1024) : stride_(std::max(stride, anchor_length)) {}
+
+    seed_index index(const sequence_buffer<byte_span>& s1) const
+    {
+        return seed_index(s1, stride_);
+    }
+
+    std::vector<anchor> find(const seed_index& seeds, const sequence_buffer<byte_span>& s2) const
+    {
+        std::vector<anchor> anchors;
+        int64_t len2 = s2.size();
+        if (seeds.length() < anchor_length || len2 < anchor_length)
+            return anchors;
+
+        uint64_t word = s2.word_at(0);
+        for (int64_t j = 0; ; ++j)
+        {
+            int64_t hit = seeds.find(word);
+            if (hit >= 0)
+                anchors.push_back(anchor{hit, j});
+
+            if (j + anchor_length >= len2)
+                break;
+            word = (word << 2) | static_cast<uint64_t>(s2[j + anchor_length]);
+        }
+
+        return anchors;
+    }
+
+    std::vector<anchor> find(const sequence_buffer<byte_span>& s1, const sequence_buffer<byte_span>& s2) const
+    {
+        return find(index(s1), s2);
+    }
+
+    // Anchors from the minimizers helix 2 shares with a k-mer index of helix 1, which only
+    // looks up the minimizers of helix 2 rather than every offset. The index must use
+    // anchor_length long k-mers. Minimizers that occur more than once in helix 1 are skipped.
+    std::vector<anchor> find(const kmer_index& kmers, const sequence_buffer<byte_span>& s2) const
+    {
+        if (kmers.k() != anchor_length)
+            throw std::invalid_argument("k-mer index anchors must be one word long");
+
+        std::vector<anchor> anchors;
+        kmers.for_each_minimizer(s2, [&kmers, &anchors](int64_t j, uint64_t kmer)
+                {
+                    auto hits = kmers.find(kmer);
+                    if (hits.size() == 1)
+                        anchors.push_back(anchor{hits.front(), j});
+                });
+
+        return anchors;
+    }
+
+    // Keeps the longest chain of anchors that move forward in both helixes (without
+    // overlapping) and drops the rest.
+    static std::vector<anchor> chain(std::vector<anchor> anchors)
+    {
+        // Ties on helix1 are ordered backwards so at most one of them can join the chain.
+        std::sort(anchors.begin(), anchors.end(), [](const anchor& a, const anchor& b)
+                {
+                    return a.helix1 < b.helix1 || (a.helix1 == b.helix1 && a.helix2 > b.helix2);
+                });
+
+        // Longest increasing subsequence on helix2 (patience sorting).
+        std::vector<std::size_t> tails;
+        std::vector<int64_t> previous(anchors.size(), -1);
+        for (std::size_t i = 0; i < anchors.size(); ++i)
+        {
+            auto pos = std::lower_bound(tails.begin(), tails.end(), anchors[i].helix2,
+                    [&anchors](std::size_t t, int64_t h2) { return anchors[t].helix2 < h2; });
+            if (pos != tails.begin())
+                previous[i] = *(pos - 1);
+            if (pos == tails.end())
+                tails.push_back(i);
+            else
+                *pos = i;
+        }
+
+        std::vector<anchor> chained;
+        for (int64_t i = tails.empty() ? -1 : tails.back(); i >= 0; i = previous[i])
+            chained.push_back(anchors[i]);
+        std::reverse(chained.begin(), chained.end());
+
+        std::vector<anchor> result;
+        for (auto& a : chained)
+        {
+            if (result.empty() || (a.helix1 - result.back().helix1 >= anchor_length
+                        && a.helix2 - result.back().helix2 >= anchor_length))
+                result.push_back(a);
+        }
+
+        return result;
+    }
+
+    // Splits two helixes into segments at chained anchors, each segment at least
+    // min_segment bases long on both helixes (apart from when the helixes are shorter). Cuts
+    // are made in the middle of an anchor, so no difference ever straddles two segments.
+    std::vector<segment> plan(const seed_index& seeds, const sequence_buffer<byte_span>& s2, int64_t min_segment) const
+    {
+        return split(find(seeds, s2), seeds.length(), s2.size(), min_segment);
+    }
+
+    std::vector<segment> plan(const kmer_index& kmers, const sequence_buffer<byte_span>& s2, int64_t min_segment) const
+    {
+        return split(find(kmers, s2), kmers.length(), s2.size(), min_segment);
+    }
+
+    std::vector<segment> plan(const sequence_buffer<byte_span>& s1, const sequence_buffer<byte_span>& s2, int64_t min_segment) const
+    {
+        return plan(index(s1), s2, min_segment);
+    }
+
+private:
+    static std::vector<segment> split(std::vector<anchor> anchors, int64_t len1, int64_t len2, int64_t min_segment)
+    {
+        std::vector<segment> segments;
+        int64_t cut1 = 0, cut2 = 0;
+
+        for (auto& a : chain(std::move(anchors)))
+        {
+            int64_t next1 = a.helix1 + anchor_length / 2, next2 = a.helix2 + anchor_length / 2;
+            if (next1 - cut1 < min_segment || next2 - cut2 < min_segment
+                    || len1 - next1 < min_segment || len2 - next2 < min_segment)
+                continue;
+
+            segments.push_back(segment{location{cut1, next1 - cut1}, location{cut2, next2 - cut2}});
+            cut1 = next1;
+            cut2 = next2;
+        }
+
+        segments.push_back(segment{location{cut1, len1 - cut1}, location{cut2, len2 - cut2}});
+        return segments;
+    }
+};
+
+} // dna
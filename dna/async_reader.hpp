@@ -0,0 +1,169 @@
+#pragma once
+
+#include "packed_stream.hpp"
+#include "person.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dna {
+
+// Reads a helix ahead of its consumer. A dedicated I/O thread pulls chunks from the wrapped
+// stream into a ring of depth reusable buffers of (at least) chunk_bases bases, so while one
+// chunk is being processed the next ones are already being fetched. With a high latency
+// stream this keeps the consumer busy instead of waiting on every read.
+//
+// The reader is a HelixStream itself, so anything that reads a helix can be given one. The
+// I/O thread starts on the first read after construction or a seek. Errors thrown by the
+// wrapped stream are rethrown by read() once the chunks before them have been consumed.
+template<HelixStream T>
+class async_chunk_reader
+{
+    struct slot
+    {
+        packed_sequence bases;
+        std::exception_ptr error;
+        bool full = false;
+        bool last = false; // the stream ended with (or before) this chunk
+    };
+
+    T helix_;
+    std::size_t chunk_bases_;
+    std::vector<slot> ring_;
+    std::size_t next_read_ = 0; // slot returned by the next read
+    std::size_t next_fill_ = 0; // slot the I/O thread fills next
+    bool lent_ = false; // the consumer holds the slot before next_read_
+    bool ended_ = false; // the consumer has seen the last chunk
+    bool stop_ = false;
+    std::mutex mutex_;
+    std::condition_variable filled_;
+    std::condition_variable freed_;
+    std::thread io_;
+
+    void fill_main()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true)
+        {
+            freed_.wait(lock, [this] { return stop_ || !ring_[next_fill_].full; });
+            if (stop_)
+                return;
+
+            // The slot is free, so the consumer won't touch it until it is marked full.
+            slot& s = ring_[next_fill_];
+            lock.unlock();
+
+            s.bases.clear();
+            s.error = nullptr;
+            s.last = false;
+            try {
+                while (s.bases.size() < chunk_bases_)
+                {
+                    auto buf = next_chunk(helix_, (chunk_bases_ - s.bases.size() + packed_size::value - 1)
+                            / packed_size::value);
+                    if (buf.size() == 0)
+                    {
+                        s.last = true;
+                        break;
+                    }
+                    s.bases.append(buf);
+                }
+            } catch (...) {
+                s.error = std::current_exception();
+                s.last = true;
+            }
+
+            lock.lock();
+            s.full = true;
+            next_fill_ = (next_fill_ + 1) % ring_.size();
+            filled_.notify_one();
+            if (s.last)
+                return;
+        }
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        freed_.notify_one();
+        if (io_.joinable())
+            io_.join();
+
+        for (auto& s : ring_)
+            s.full = false;
+        next_read_ = next_fill_ = 0;
+        lent_ = ended_ = stop_ = false;
+    }
+
+public:
+    static constexpr std::size_t default_depth = 2;
+    static constexpr std::size_t default_chunk_bases = 1 << 20;
+
+    explicit async_chunk_reader(T helix, std::size_t depth = default_depth,
+            std::size_t chunk_bases = default_chunk_bases)
+        : helix_(std::move(helix)), chunk_bases_(std::max(chunk_bases, packed_size::value)),
+          ring_(std::max<std::size_t>(depth, 1) + 1) // one more for the chunk that is lent out
+    {
+        for (auto& s : ring_)
+            s.bases.reserve(chunk_bases_);
+    }
+
+    ~async_chunk_reader()
+    {
+        stop();
+    }
+
+    async_chunk_reader(const async_chunk_reader&) = delete;
+    async_chunk_reader& operator=(const async_chunk_reader&) = delete;
+
+    // Discards the chunks read ahead and restarts reading from offset (rounded down to a byte
+    // by streams that can only read from one).
+    void seek(long offset)
+    {
+        stop();
+        helix_.seek(offset);
+    }
+
+    long size() const
+    {
+        return helix_.size();
+    }
+
+    // The next chunk, valid until the next call to read() or seek(). An empty chunk once the
+    // helix has been read.
+    sequence_buffer<byte_span> read()
+    {
+        if (!io_.joinable())
+            io_ = std::thread(&async_chunk_reader::fill_main, this);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (lent_)
+        {
+            std::size_t previous = (next_read_ + ring_.size() - 1) % ring_.size();
+            ring_[previous].full = false;
+            lent_ = false;
+            freed_.notify_one();
+        }
+
+        if (ended_)
+            return sequence_buffer<byte_span>(byte_span(), 0);
+
+        filled_.wait(lock, [this] { return ring_[next_read_].full; });
+        slot& s = ring_[next_read_];
+        next_read_ = (next_read_ + 1) % ring_.size();
+        lent_ = true;
+        ended_ = s.last;
+
+        if (s.error)
+            std::rethrow_exception(s.error);
+        return s.bases.view();
+    }
+};
+
+} // dna
@@ -0,0 +1,219 @@
+#pragma once
+
+#include "anchor_chain.hpp"
+#include "packed_stream.hpp"
+#include "pairwise_aligner.hpp"
+#include "segmented_aligner.hpp"
+#include "thread_pool.hpp"
+#include <atomic>
+#include <future>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace dna {
+
+// A reference chromosome loaded and indexed once, then shared read only by every comparison
+// against it.
+struct prepared_chromosome
+{
+    helix_bases sequence;
+    std::shared_ptr<const seed_index> seeds;
+};
+
+// Compares one reference person against many others. Every reference chromosome is read,
+// packed and seed indexed once, no matter how many people it is compared with.
+//
+// Chromosomes are aligned whole, telomeres included, the same as pairwise_aligner does, so a
+// pair of people gets the same mutations and scores from either. Callers that want telomeres
+// left out can find them with trim_telomeres (telomere.hpp).
+//
+// All work runs as tasks on the pool: one task per reference chromosome prepares it and then
+// submits one task per person that reads, segments (using the shared seed index) and aligns
+// that person's chromosome. Nothing waits inside the pool, so it may be shared with other work.
+class cohort_aligner
+{
+    // Tracks the chromosomes outstanding for every person and for the cohort as a whole.
+    template<typename F>
+    class cohort_state
+    {
+        struct person_state
+        {
+            std::vector<alignment_result> results;
+            std::atomic<std::size_t> pending;
+        };
+
+        std::unique_ptr<person_state[]> people_;
+        std::atomic<std::size_t> pending_;
+        F on_result_;
+        std::promise<void> promise_;
+
+        void release()
+        {
+            if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                promise_.set_value();
+        }
+
+    public:
+        // pending_ counts every person plus one, so the promise can't be fulfilled before all
+        // chromosomes have been submitted.
+        cohort_state(std::size_t people, std::size_t chromosomes, F&& on_result)
+            : people_(new person_state[people]), pending_(people + 1), on_result_(std::move(on_result))
+        {
+            for (std::size_t i = 0; i < people; ++i)
+            {
+                people_[i].results.resize(chromosomes);
+                people_[i].pending.store(chromosomes, std::memory_order_relaxed);
+            }
+        }
+
+        std::future<void> get_future()
+        {
+            return promise_.get_future();
+        }
+
+        void complete(std::size_t person, std::size_t chromosome, alignment_result&& result)
+        {
+            person_state& state = people_[person];
+            state.results[chromosome] = std::move(result);
+            if (state.pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                on_result_(person, std::move(state.results));
+                release();
+            }
+        }
+
+        // Called once every chromosome has been submitted.
+        void seal()
+        {
+            release();
+        }
+    };
+
+    thread_pool& pool_;
+    const sequence_aligner<packed_stream>& aligner_;
+    const scheduling_policy& schedule_;
+    int64_t min_segment_;
+    anchor_finder finder_;
+
+    alignment_result compare(const prepared_chromosome& reference,
+            const helix_bases& s2) const
+    {
+        alignment_result res;
+        if (reference.sequence.empty() && s2.empty())
+        {
+            res.similarity_score = 1;
+            return res;
+        }
+
+        if (reference.sequence.empty() || s2.empty())
+        {
+            res.error = NoDataErr;
+            return res;
+        }
+
+        std::vector<segment> segments = finder_.plan(*reference.seeds, s2.view(), min_segment_);
+
+        std::vector<alignment_result> results;
+        results.reserve(segments.size());
+        for (auto& seg : segments)
+            results.push_back(align_segment(aligner_, reference.sequence, s2, seg));
+
+        return stitch_segments(segments, std::move(results), reference.sequence.size(), s2.size());
+    }
+
+public:
+    explicit cohort_aligner(thread_pool& pool, const sequence_aligner<packed_stream>& aligner,
+            int64_t min_segment = 1 << 16, int64_t anchor_stride = 1024,
+            const scheduling_policy& schedule = largest_first_policy::instance())
+        : pool_(pool), aligner_(aligner), schedule_(schedule), min_segment_(min_segment), finder_(anchor_stride)
+    {}
+
+    // Loads and indexes one chromosome.
+    template<HelixStream T>
+    prepared_chromosome prepare(T& helix) const
+    {
+        helix_bases seq = read_helix(helix);
+        auto seeds = std::make_shared<const seed_index>(finder_.index(seq.view()));
+        return prepared_chromosome{std::move(seq), std::move(seeds)};
+    }
+
+    // Compares reference with every person in others. on_result(index, results) is called once
+    // per person, with the person's position in others and its chromosome results, as soon as
+    // that person's comparison finishes. It runs on pool threads (possibly several at once) and
+    // must not block. The returned future is ready once on_result has returned for everyone.
+    // others must outlive the returned future.
+    template<typename P, typename R, typename F> requires (Person<P> && IsPerson<P>)
+    std::future<void> analyze_cohort_async(P& reference, R& others, F on_result) const
+    {
+        std::vector<P*> people;
+        for (P& person : others)
+            people.push_back(&person);
+
+        const std::size_t count = reference.chromosomes();
+        auto state = std::make_shared<cohort_state<F>>(people.size(), count, std::move(on_result));
+        auto done = state->get_future();
+        if (people.empty())
+        {
+            state->seal();
+            return done;
+        }
+
+        // The reference streams are taken once, for their sizes and then by the task preparing
+        // each of them.
+        using stream = std::decay_t<decltype(reference.chromosome(0))>;
+        auto helixes = std::make_shared<std::vector<stream>>();
+        std::vector<long> sizes;
+        helixes->reserve(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            helixes->push_back(reference.chromosome(i));
+            sizes.push_back(helixes->back().size());
+        }
+
+        auto shared_people = std::make_shared<const std::vector<P*>>(std::move(people));
+        for (std::size_t index : schedule_.order(sizes))
+        {
+            pool_.enqueue([this, state, shared_people, helixes, index]
+                    {
+                        std::shared_ptr<const prepared_chromosome> prepared;
+                        try {
+                            prepared = std::make_shared<const prepared_chromosome>(prepare((*helixes)[index]));
+                        } catch (const std::exception& e) {
+                            for (std::size_t p = 0; p < shared_people->size(); ++p)
+                            {
+                                alignment_result res;
+                                res.error = e.what();
+                                state->complete(p, index, std::move(res));
+                            }
+                            return;
+                        }
+
+                        for (std::size_t p = 0; p < shared_people->size(); ++p)
+                        {
+                            P* person = (*shared_people)[p];
+                            pool_.enqueue([this, state, prepared, person, p, index]
+                                    {
+                                        alignment_result res;
+                                        try {
+                                            auto other = person->chromosome(index);
+                                            if (index == sex_chromosome
+                                                    && is_xy_mismatch(prepared->sequence.size(), other.size()))
+                                                res.error = std::string(ChromoMismatchMFErr);
+                                            else
+                                                res = compare(*prepared, read_helix(other));
+                                        } catch (const std::exception& e) {
+                                            res.error = e.what();
+                                        }
+                                        state->complete(p, index, std::move(res));
+                                    });
+                        }
+                    });
+        }
+
+        state->seal();
+        return done;
+    }
+};
+
+} // dna
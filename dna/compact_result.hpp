@@ -0,0 +1,344 @@
+#pragma once
+
+#include "sequence_aligner.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dna {
+
+namespace detail {
+
+// LEB128: 7 bits per byte, low bits first, the top bit set on every byte but the last.
+inline std::size_t varint_size(std::uint64_t value)
+{
+    std::size_t size = 1;
+    while (value >= 0x80)
+    {
+        value >>= 7;
+        ++size;
+    }
+    return size;
+}
+
+inline void put_varint(std::byte*& out, std::uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        *out++ = static_cast<std::byte>(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = static_cast<std::byte>(value);
+}
+
+inline std::uint64_t get_varint(const std::byte*& in)
+{
+    std::uint64_t value = 0;
+    for (int shift = 0; ; shift += 7)
+    {
+        auto b = static_cast<std::uint64_t>(*in++);
+        value |= (b & 0x7f) << shift;
+        if ((b & 0x80) == 0)
+            return value;
+    }
+}
+
+// Maps signed values to unsigned ones with small magnitudes staying small (0, -1, 1, -2, ...).
+constexpr std::uint64_t zigzag(std::int64_t value)
+{
+    return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+constexpr std::int64_t unzigzag(std::uint64_t value)
+{
+    return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+}
+
+} // detail
+
+// Bump allocator for the results of one comparison. Everything allocated from it is freed at
+// once when it is cleared or destroyed, there is no per result bookkeeping.
+class result_arena
+{
+    std::vector<std::unique_ptr<std::byte[]>> blocks_;
+    std::size_t block_bytes_;
+    std::size_t used_ = 0; // of the last block
+    std::size_t last_bytes_ = 0; // size of the last block
+    std::size_t total_ = 0;
+
+public:
+    explicit result_arena(std::size_t block_bytes = 1 << 16) : block_bytes_(std::max<std::size_t>(block_bytes, 64)) {}
+
+    result_arena(const result_arena&) = delete;
+    result_arena& operator=(const result_arena&) = delete;
+
+    std::byte* allocate(std::size_t bytes)
+    {
+        if (blocks_.empty() || last_bytes_ - used_ < bytes)
+        {
+            // Allocations larger than a block get a block of their own.
+            last_bytes_ = std::max(block_bytes_, bytes);
+            blocks_.emplace_back(new std::byte[last_bytes_]);
+            used_ = 0;
+        }
+
+        std::byte* p = blocks_.back().get() + used_;
+        used_ += bytes;
+        total_ += bytes;
+        return p;
+    }
+
+    // Bytes handed out since the arena was created or cleared.
+    std::size_t bytes_used() const
+    {
+        return total_;
+    }
+
+    // Frees every allocation, invalidating all results allocated from the arena.
+    void clear()
+    {
+        blocks_.clear();
+        used_ = last_bytes_ = total_ = 0;
+    }
+};
+
+// Why an alignment failed. The errors every aligner reports have a code of their own, any
+// other error is kept as a message.
+enum class result_error : std::uint8_t
+{
+    none,
+    no_data,
+    sex_chromosome_mismatch,
+    other,
+};
+
+// The code of an alignment_result error.
+inline result_error error_code(const std::string& error)
+{
+    if (error.empty())
+        return result_error::none;
+    if (error == NoDataErr)
+        return result_error::no_data;
+    if (error == ChromoMismatchMFErr)
+        return result_error::sex_chromosome_mismatch;
+    return result_error::other;
+}
+
+// The message of an error code, other errors have their own message.
+inline std::string_view error_message(result_error code, std::string_view other)
+{
+    switch (code)
+    {
+    case result_error::none:
+        return std::string_view();
+    case result_error::no_data:
+        return NoDataErr;
+    case result_error::sex_chromosome_mismatch:
+        return ChromoMismatchMFErr;
+    default:
+        return other;
+    }
+}
+
+// An alignment_result encoded into a result_arena. Each mutation is stored as varints: the
+// gap since the end of the previous mutation on helix 1, how far helix 2 drifted from helix 1
+// over that gap (zigzag encoded, 0 unless there was an indel) and the two lengths. A SNP a
+// few hundred bases after the previous mutation takes 5 bytes instead of 32. Mutations out of
+// order still round trip, a negative gap just takes the full 10 bytes.
+//
+// A compact_result is a small view into the arena and is trivially copyable. It is valid as
+// long as the arena it was encoded into is not cleared or destroyed. Mutations are decoded on
+// the fly while iterating.
+class compact_result
+{
+    const std::byte* data_ = nullptr;
+    std::uint32_t count_ = 0;
+    std::uint32_t bytes_ = 0;
+    double similarity_score_ = 0;
+    result_error error_ = result_error::none;
+    const char* message_ = nullptr; // only for result_error::other
+    std::uint32_t message_length_ = 0;
+
+public:
+    class iterator
+    {
+        const std::byte* p_ = nullptr;
+        std::uint32_t remaining_ = 0;
+        int64_t end1_ = 0; // end of the previous mutation in each helix
+        int64_t end2_ = 0;
+        mutation current_{location{}, location{}};
+
+        void decode()
+        {
+            if (remaining_ == 0)
+                return;
+
+            int64_t gap = static_cast<int64_t>(detail::get_varint(p_));
+            int64_t drift = detail::unzigzag(detail::get_varint(p_));
+            current_.helix1.offset = end1_ + gap;
+            current_.helix2.offset = end2_ + gap + drift;
+            current_.helix1.length = static_cast<int64_t>(detail::get_varint(p_));
+            current_.helix2.length = static_cast<int64_t>(detail::get_varint(p_));
+            end1_ = current_.helix1.offset + current_.helix1.length;
+            end2_ = current_.helix2.offset + current_.helix2.length;
+        }
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = mutation;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const mutation*;
+        using reference = const mutation&;
+
+        iterator() = default;
+
+        iterator(const std::byte* p, std::uint32_t count) : p_(p), remaining_(count)
+        {
+            decode();
+        }
+
+        const mutation& operator*() const
+        {
+            return current_;
+        }
+
+        const mutation* operator->() const
+        {
+            return &current_;
+        }
+
+        iterator& operator++()
+        {
+            --remaining_;
+            decode();
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator it = *this;
+            ++*this;
+            return it;
+        }
+
+        bool operator==(const iterator& other) const
+        {
+            return remaining_ == other.remaining_;
+        }
+
+        bool operator!=(const iterator& other) const
+        {
+            return !(*this == other);
+        }
+    };
+
+    compact_result() = default;
+
+    // Encodes res into arena.
+    static compact_result encode(const alignment_result& res, result_arena& arena)
+    {
+        compact_result c;
+        c.similarity_score_ = res.similarity_score;
+        c.count_ = static_cast<std::uint32_t>(res.mutations.size());
+
+        c.error_ = error_code(res.error);
+        if (c.error_ == result_error::other)
+        {
+            c.message_length_ = static_cast<std::uint32_t>(res.error.size());
+            char* message = reinterpret_cast<char*>(arena.allocate(res.error.size()));
+            std::memcpy(message, res.error.data(), res.error.size());
+            c.message_ = message;
+        }
+
+        // Sized first so the encoding is allocated in one piece.
+        std::size_t bytes = 0;
+        int64_t end1 = 0, end2 = 0;
+        for (auto& mut : res.mutations)
+        {
+            int64_t gap = mut.helix1.offset - end1;
+            bytes += detail::varint_size(static_cast<std::uint64_t>(gap))
+                + detail::varint_size(detail::zigzag(mut.helix2.offset - end2 - gap))
+                + detail::varint_size(static_cast<std::uint64_t>(mut.helix1.length))
+                + detail::varint_size(static_cast<std::uint64_t>(mut.helix2.length));
+            end1 = mut.helix1.offset + mut.helix1.length;
+            end2 = mut.helix2.offset + mut.helix2.length;
+        }
+
+        std::byte* out = bytes == 0 ? nullptr : arena.allocate(bytes);
+        c.data_ = out;
+        c.bytes_ = static_cast<std::uint32_t>(bytes);
+        end1 = end2 = 0;
+        for (auto& mut : res.mutations)
+        {
+            int64_t gap = mut.helix1.offset - end1;
+            detail::put_varint(out, static_cast<std::uint64_t>(gap));
+            detail::put_varint(out, detail::zigzag(mut.helix2.offset - end2 - gap));
+            detail::put_varint(out, static_cast<std::uint64_t>(mut.helix1.length));
+            detail::put_varint(out, static_cast<std::uint64_t>(mut.helix2.length));
+            end1 = mut.helix1.offset + mut.helix1.length;
+            end2 = mut.helix2.offset + mut.helix2.length;
+        }
+
+        return c;
+    }
+
+    iterator begin() const
+    {
+        return iterator(data_, count_);
+    }
+
+    iterator end() const
+    {
+        return iterator();
+    }
+
+    std::size_t size() const
+    {
+        return count_;
+    }
+
+    bool empty() const
+    {
+        return count_ == 0;
+    }
+
+    // Bytes the mutations are encoded in.
+    std::size_t encoded_bytes() const
+    {
+        return bytes_;
+    }
+
+    double similarity_score() const
+    {
+        return similarity_score_;
+    }
+
+    result_error error() const
+    {
+        return error_;
+    }
+
+    // The error message, empty if the alignment succeeded.
+    std::string_view message() const
+    {
+        return error_message(error_, std::string_view(message_, message_length_));
+    }
+
+    // Decodes back into an alignment_result.
+    alignment_result to_result() const
+    {
+        std::vector<mutation> muts;
+        muts.reserve(count_);
+        for (auto& mut : *this)
+            muts.push_back(mut);
+
+        return alignment_result(std::move(muts), std::string(message()), similarity_score_);
+    }
+};
+
+} // dna
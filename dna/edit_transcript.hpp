@@ -0,0 +1,96 @@
+#pragma once
+
+#include "sequence_aligner.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace dna {
+
+// A single step of an alignment between two helixes.
+enum class edit_op : char
+{
+    match,
+    mismatch,
+    gap_helix1, // base only present in helix 2
+    gap_helix2, // base only present in helix 1
+};
+
+// A run of identical consecutive edit operations.
+struct edit_run
+{
+    edit_op op;
+    int64_t length;
+};
+
+// Run length encoded description of an alignment. Identical strands collapse into a handful
+// of runs, so the transcript grows with the number of differences rather than with the
+// length of the helixes.
+class edit_transcript
+{
+    std::vector<edit_run> runs_;
+
+public:
+    void push(edit_op op, int64_t count = 1)
+    {
+        if (count <= 0)
+            return;
+
+        if (!runs_.empty() && runs_.back().op == op)
+            runs_.back().length += count;
+        else
+            runs_.push_back(edit_run{op, count});
+    }
+
+    void append(const edit_transcript& other)
+    {
+        for (auto& run : other.runs_)
+            push(run.op, run.length);
+    }
+
+    const std::vector<edit_run>& runs() const
+    {
+        return runs_;
+    }
+
+    bool empty() const
+    {
+        return runs_.empty();
+    }
+
+    // Converts the transcript into mutations, every maximal stretch of non matching
+    // operations becoming one mutation. Offsets are relative to the given helix offsets.
+    std::vector<mutation> mutations(int64_t helix1_offset = 0, int64_t helix2_offset = 0) const
+    {
+        std::vector<mutation> muts;
+        int64_t s1 = helix1_offset, s2 = helix2_offset;
+        int64_t s1_start = -1, s2_start = -1;
+
+        for (auto& run : runs_)
+        {
+            if (run.op == edit_op::match)
+            {
+                if (s1_start != -1) // mutation ended, save it
+                {
+                    muts.emplace_back(location{s1_start, s1 - s1_start}, location{s2_start, s2 - s2_start});
+                    s1_start = -1;
+                }
+            } else if (s1_start == -1)
+            {
+                s1_start = s1;
+                s2_start = s2;
+            }
+
+            if (run.op != edit_op::gap_helix1)
+                s1 += run.length;
+            if (run.op != edit_op::gap_helix2)
+                s2 += run.length;
+        }
+
+        if (s1_start != -1)
+            muts.emplace_back(location{s1_start, s1 - s1_start}, location{s2_start, s2 - s2_start});
+
+        return muts;
+    }
+};
+
+} // dna
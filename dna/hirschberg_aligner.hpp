@@ -0,0 +1,353 @@
+#pragma once
+
+#include "edit_transcript.hpp"
+#include "packed_stream.hpp"
+#include "person.hpp"
+#include "scoring.hpp"
+#include "sequence_aligner.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <future>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace dna {
+
+// Exact global (Needleman-Wunsch) alignment in linear space, scored by a ScoringPolicy with
+// linear gaps (FOGSAA's scores by default). Helix 1 is
+// split in half, one pass scores the first half against every prefix of helix 2 and another
+// the second half against every suffix, and the helix 2 offset where the two add up to the
+// best total is where the best alignment crosses the middle (Hirschberg). Both halves are
+// split the same way until they are small enough for a full matrix with a traceback.
+//
+// Only the last row of the matrix is kept while scoring, so memory grows with the length of
+// the helixes and not with their product. Rows hold int32 scores where a pass is short enough
+// for every score to fit, which packs twice the columns in a register, and int64 otherwise
+// (chromosome scale). With a pool the two passes of a split, and then its two halves, run as
+// tasks of their own, so the halves split recursively all over the pool. The engine may run on
+// that pool itself: it waits for its tasks through thread_pool::wait, which keeps running
+// queued tasks meanwhile.
+template<ScoringPolicy Scoring = fogsaa_scoring>
+class hirschberg_engine
+{
+    struct range
+    {
+        int64_t x0;
+        int64_t n1;
+        int64_t y0;
+        int64_t n2;
+    };
+
+    Scoring scoring_;
+    thread_pool* pool_;
+    int64_t leaf_cells_;
+    int64_t max_step_; // the most one substitution or gap changes a score by
+
+    int32_t gap_score() const
+    {
+        return scoring_.gap_extend();
+    }
+
+    int32_t substitution(int32_t a, int32_t b) const
+    {
+        return scoring_.substitution(static_cast<base>(a), static_cast<base>(b));
+    }
+
+    static std::vector<int32_t> unpack(const sequence_buffer<byte_span>& seq, int64_t offset, int64_t length,
+            bool reverse)
+    {
+        std::vector<int32_t> codes(length);
+        for (int64_t i = 0; i < length; ++i)
+            codes[reverse ? length - 1 - i : i] = static_cast<int32_t>(seq[offset + i]);
+        return codes;
+    }
+
+    // One row of the matrix from the one above it, up to the gaps along the row: row[j] is set
+    // to the best of the diagonal and vertical moves into column j. Columns are independent
+    // here, so they are computed a register at a time, the scores of base a against the four
+    // bases held in a register and picked by each column's base.
+    template<typename Cell>
+    void diagonal_and_up(const Cell* prev, Cell* row, const int32_t* codes2, int32_t a, int64_t n2) const
+    {
+        const Cell subs[4] = { substitution(a, 0), substitution(a, 1), substitution(a, 2), substitution(a, 3) };
+        const Cell gap = gap_score();
+        int64_t j = 1;
+        if constexpr (std::is_same<Cell, int32_t>::value)
+        {
+#if defined(__AVX2__)
+            const __m256i vsubs = _mm256_setr_epi32(subs[0], subs[1], subs[2], subs[3], 0, 0, 0, 0);
+            const __m256i vgap = _mm256_set1_epi32(gap);
+            for (; j + 8 <= n2 + 1; j += 8)
+            {
+                auto codes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(codes2 + j - 1));
+                auto diag = _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(prev + j - 1)),
+                        _mm256_permutevar8x32_epi32(vsubs, codes));
+                auto up = _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(prev + j)), vgap);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(row + j), _mm256_max_epi32(diag, up));
+            }
+#elif defined(__SSE2__)
+            const __m128i vgap = _mm_set1_epi32(gap);
+            for (; j + 4 <= n2 + 1; j += 4)
+            {
+                auto codes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(codes2 + j - 1));
+                auto diag = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + j - 1));
+                for (int32_t b = 0; b < 4; ++b) // no variable shuffle before AVX2
+                    diag = _mm_add_epi32(diag, _mm_and_si128(_mm_cmpeq_epi32(codes, _mm_set1_epi32(b)),
+                            _mm_set1_epi32(subs[b])));
+                auto up = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + j)), vgap);
+                auto greater = _mm_cmpgt_epi32(diag, up); // no 32 bit max before SSE4.1
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(row + j),
+                        _mm_or_si128(_mm_and_si128(greater, diag), _mm_andnot_si128(greater, up)));
+            }
+#endif
+        } else
+        {
+#if defined(__AVX2__)
+            // Each column's base picks the two 32 bit halves of its 64 bit score.
+            const __m256i vsubs = _mm256_setr_epi64x(subs[0], subs[1], subs[2], subs[3]);
+            const __m256i vgap = _mm256_set1_epi64x(gap);
+            const __m256i one = _mm256_set1_epi64x(1);
+            for (; j + 4 <= n2 + 1; j += 4)
+            {
+                auto codes = _mm256_slli_epi64(_mm256_cvtepi32_epi64(
+                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(codes2 + j - 1))), 1);
+                auto halves = _mm256_or_si256(codes, _mm256_slli_epi64(_mm256_add_epi64(codes, one), 32));
+                auto diag = _mm256_add_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(prev + j - 1)),
+                        _mm256_permutevar8x32_epi32(vsubs, halves));
+                auto up = _mm256_add_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(prev + j)), vgap);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(row + j),
+                        _mm256_blendv_epi8(up, diag, _mm256_cmpgt_epi64(diag, up))); // no 64 bit max before AVX-512
+            }
+#endif
+        }
+        for (; j <= n2; ++j)
+            row[j] = std::max(prev[j - 1] + subs[codes2[j - 1]], prev[j] + gap);
+    }
+
+    // Best scores of aligning all of codes1 against every prefix of codes2.
+    template<typename Cell>
+    std::vector<int64_t> last_row(const std::vector<int32_t>& codes1, const std::vector<int32_t>& codes2) const
+    {
+        const int64_t n2 = codes2.size();
+        const Cell gap = gap_score();
+        std::vector<Cell> prev(n2 + 1), row(n2 + 1);
+        for (int64_t j = 0; j <= n2; ++j)
+            prev[j] = static_cast<Cell>(j) * gap;
+
+        for (std::size_t i = 0; i < codes1.size(); ++i)
+        {
+            diagonal_and_up(prev.data(), row.data(), codes2.data(), codes1[i], n2);
+
+            // The gaps along the row depend on the column before, they are added in order.
+            Cell run = static_cast<Cell>(i + 1) * gap;
+            row[0] = run;
+            for (int64_t j = 1; j <= n2; ++j)
+            {
+                run = std::max(row[j], run + gap);
+                row[j] = run;
+            }
+            std::swap(prev, row);
+        }
+        return std::vector<int64_t>(prev.begin(), prev.end());
+    }
+
+    // Whether every score of an n1 by n2 matrix (and the sums that make it) fits in an int32.
+    bool fits_int32(int64_t n1, int64_t n2) const
+    {
+        return n1 + n2 + 1 <= std::numeric_limits<int32_t>::max() / std::max<int64_t>(max_step_, 1);
+    }
+
+    // Scores of the first half of r against the prefixes of its part of helix 2 (reverse
+    // false) or of the second half against the suffixes (reverse true, indexed by length).
+    std::vector<int64_t> half_scores(const sequence_buffer<byte_span>& v1, const sequence_buffer<byte_span>& v2,
+            const range& r, bool reverse) const
+    {
+        int64_t mid = r.n1 / 2;
+        auto codes1 = reverse ? unpack(v1, r.x0 + mid, r.n1 - mid, true) : unpack(v1, r.x0, mid, false);
+        auto codes2 = unpack(v2, r.y0, r.n2, reverse);
+        return fits_int32(codes1.size(), codes2.size()) ? last_row<int32_t>(codes1, codes2)
+                : last_row<int64_t>(codes1, codes2);
+    }
+
+    // Full matrix alignment of a small range.
+    edit_transcript align_leaf(const sequence_buffer<byte_span>& v1, const sequence_buffer<byte_span>& v2,
+            const range& r) const
+    {
+        enum : char { diagonal, up, left };
+        const int64_t cols = r.n2 + 1;
+        auto codes1 = unpack(v1, r.x0, r.n1, false), codes2 = unpack(v2, r.y0, r.n2, false);
+        std::vector<char> moves((r.n1 + 1) * cols, diagonal);
+        std::vector<int64_t> prev(cols), row(cols);
+
+        for (int64_t j = 0; j < cols; ++j)
+        {
+            prev[j] = j * gap_score();
+            moves[j] = left;
+        }
+        for (int64_t i = 1; i <= r.n1; ++i)
+        {
+            row[0] = i * gap_score();
+            moves[i * cols] = up;
+            for (int64_t j = 1; j < cols; ++j)
+            {
+                int64_t best = prev[j - 1] + substitution(codes1[i - 1], codes2[j - 1]);
+                char move = diagonal;
+                if (prev[j] + gap_score() > best)
+                {
+                    best = prev[j] + gap_score();
+                    move = up;
+                }
+                if (row[j - 1] + gap_score() > best)
+                {
+                    best = row[j - 1] + gap_score();
+                    move = left;
+                }
+                row[j] = best;
+                moves[i * cols + j] = move;
+            }
+            std::swap(prev, row);
+        }
+
+        std::vector<edit_op> ops;
+        for (int64_t i = r.n1, j = r.n2; i > 0 || j > 0; )
+        {
+            switch (moves[i * cols + j])
+            {
+            case diagonal:
+                ops.push_back(codes1[i - 1] == codes2[j - 1] ? edit_op::match : edit_op::mismatch);
+                --i;
+                --j;
+                break;
+            case up:
+                ops.push_back(edit_op::gap_helix2);
+                --i;
+                break;
+            default:
+                ops.push_back(edit_op::gap_helix1);
+                --j;
+            }
+        }
+
+        edit_transcript transcript;
+        for (auto it = ops.rbegin(); it != ops.rend(); ++it)
+            transcript.push(*it);
+        return transcript;
+    }
+
+    bool is_leaf(const range& r) const
+    {
+        return r.n1 < 2 || r.n2 == 0 || (r.n1 + 1) * (r.n2 + 1) <= leaf_cells_;
+    }
+
+    // Runs f here and g as a task of the pool (if there is one) at the same time, and returns
+    // both results. g is always waited for, it may refer to the caller's locals.
+    template<typename F, typename G>
+    auto both(F f, G g) const -> std::pair<decltype(f()), decltype(g())>
+    {
+        if (pool_ == nullptr)
+        {
+            auto first = f();
+            return { std::move(first), g() };
+        }
+
+        auto second = pool_->enqueue(g);
+        try {
+            auto first = f();
+            return { std::move(first), pool_->wait(second) };
+        } catch (...) {
+            try {
+                pool_->wait(second);
+            } catch (...) {
+            }
+            throw;
+        }
+    }
+
+    // The edits of the best alignment of r: its halves are split where the best alignment
+    // crosses the middle of helix 1 and aligned independently, until they are leaves.
+    edit_transcript solve(const sequence_buffer<byte_span>& v1, const sequence_buffer<byte_span>& v2,
+            const range& r) const
+    {
+        if (is_leaf(r))
+            return align_leaf(v1, v2, r);
+
+        auto scores = both([&] { return half_scores(v1, v2, r, false); },
+                [&] { return half_scores(v1, v2, r, true); });
+        const auto& front = scores.first, & back = scores.second;
+        int64_t best = 0;
+        for (int64_t j = 1; j <= r.n2; ++j)
+            if (front[j] + back[r.n2 - j] > front[best] + back[r.n2 - best])
+                best = j;
+
+        int64_t mid = r.n1 / 2;
+        const range left{r.x0, mid, r.y0, best}, right{r.x0 + mid, r.n1 - mid, r.y0 + best, r.n2 - best};
+        auto halves = both([&] { return solve(v1, v2, left); }, [&] { return solve(v1, v2, right); });
+        halves.first.append(halves.second);
+        return std::move(halves.first);
+    }
+
+public:
+    explicit hirschberg_engine(thread_pool* pool = nullptr, int64_t leaf_cells = 1 << 20,
+            const Scoring& scoring = Scoring())
+        : scoring_(scoring), pool_(pool), leaf_cells_(std::max<int64_t>(leaf_cells, 4)),
+          max_step_(std::max({ std::abs(int64_t{scoring_.gap_extend()}),
+                  std::abs(int64_t{best_substitution(scoring_)}), std::abs(int64_t{worst_substitution(scoring_)}) }))
+    {
+        if (scoring_.gap_open() != 0)
+            throw std::invalid_argument("hirschberg_engine only scores linear gaps");
+    }
+
+    // The edits of the best alignment of two loaded helixes.
+    edit_transcript transcribe(const sequence_buffer<byte_span>& v1, const sequence_buffer<byte_span>& v2) const
+    {
+        return solve(v1, v2, range{0, static_cast<int64_t>(v1.size()), 0, static_cast<int64_t>(v2.size())});
+    }
+};
+
+// Aligns helix pairs with a hirschberg_engine. Slow (the time still grows with the product of
+// the helix lengths) but exact in bounded memory, for validating the faster engines and as a
+// fall back when they can't align a pair.
+template<HelixStream T, ScoringPolicy Scoring = fogsaa_scoring>
+class hirschberg_aligner : public sequence_aligner<T>
+{
+    hirschberg_engine<Scoring> engine_;
+
+public:
+    explicit hirschberg_aligner(thread_pool* pool = nullptr, int64_t leaf_cells = 1 << 20,
+            const Scoring& scoring = Scoring())
+        : engine_(pool, leaf_cells, scoring)
+    {}
+
+    alignment_result align(T& a, T& b) const override
+    {
+        alignment_result res;
+        if (a.size() == 0 && b.size() == 0)
+        {
+            res.similarity_score = 1;
+            return res;
+        }
+
+        if (a.size() == 0 || b.size() == 0)
+        {
+            res.error = NoDataErr;
+            return res;
+        }
+
+        helix_bases s1 = read_helix(a);
+        helix_bases s2 = read_helix(b);
+        res.mutations = engine_.transcribe(s1.view(), s2.view()).mutations();
+
+        double total_muts = 0;
+        for (auto& mut : res.mutations)
+            total_muts += mut.helix1.length;
+        res.similarity_score = 1 - (total_muts / std::max(s1.size(), s2.size()));
+        return res;
+    }
+};
+
+} // dna
@@ -0,0 +1,285 @@
+#pragma once
+
+#include "packed_sequence.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+namespace dna {
+
+// Index of the k-mers of one helix, for finding where a query (a region of another person's
+// helix) sits without aligning the whole helix. Only minimizers are stored: of every w
+// consecutive k-mers the one with the smallest hash, so the index holds roughly 2/(w+1) of
+// the k-mers while any match of at least w + k - 1 bases still shares a k-mer with it.
+//
+// k-mers are packed 2 bits per base (k <= 32) the same way the helix is, so they are read
+// straight from the packed bytes.
+class kmer_index
+{
+public:
+    struct entry
+    {
+        std::uint64_t kmer;
+        std::int64_t offset;
+
+        bool operator<(const entry& e) const
+        {
+            return kmer < e.kmer || (kmer == e.kmer && offset < e.offset);
+        }
+    };
+
+    // Where the query could start in the indexed helix and how many of the query's
+    // minimizers agree on it.
+    struct candidate
+    {
+        std::int64_t offset;
+        std::size_t hits;
+    };
+
+private:
+    static constexpr char magic[8] = {'D', 'N', 'A', 'K', 'M', 'E', 'R', '1'};
+
+    std::uint32_t k_;
+    std::uint32_t w_;
+    std::int64_t length_ = 0;
+    std::vector<entry> entries_; // sorted by k-mer, then offset
+
+    struct minimizer
+    {
+        std::int64_t offset;
+        std::uint64_t hash;
+        std::uint64_t kmer;
+    };
+
+    // Invertible mix so the minimizers are not biased towards low (A rich) k-mers.
+    static constexpr std::uint64_t hash(std::uint64_t kmer)
+    {
+        kmer ^= kmer >> 33;
+        kmer *= 0xff51afd7ed558ccdULL;
+        kmer ^= kmer >> 33;
+        kmer *= 0xc4ceb9fe1a85ec53ULL;
+        kmer ^= kmer >> 33;
+        return kmer;
+    }
+
+    // Bytes from the read position to the end of in, or the most any stream could hold if in
+    // can't seek.
+    static std::uint64_t bytes_left(std::istream& in)
+    {
+        auto here = in.tellg();
+        if (here == std::istream::pos_type(-1))
+            return std::numeric_limits<std::uint64_t>::max();
+
+        in.seekg(0, std::ios::end);
+        auto end = in.tellg();
+        in.seekg(here);
+        if (end == std::istream::pos_type(-1) || !in)
+        {
+            in.clear();
+            in.seekg(here);
+            return std::numeric_limits<std::uint64_t>::max();
+        }
+        return static_cast<std::uint64_t>(end - here);
+    }
+
+public:
+    // k defaults to a full word so matches are as long as the anchors chained by anchor_finder.
+    explicit kmer_index(std::uint32_t k = word_bases, std::uint32_t w = 16)
+        : k_(std::min<std::uint32_t>(std::max<std::uint32_t>(k, 1), word_bases)), w_(std::max<std::uint32_t>(w, 1))
+    {}
+
+    // Indexes the minimizers of seq.
+    template<ByteBuffer B>
+    kmer_index(const sequence_buffer<B>& seq, std::uint32_t k = word_bases, std::uint32_t w = 16) : kmer_index(k, w)
+    {
+        length_ = seq.size();
+        for_each_minimizer(seq, [this](std::int64_t offset, std::uint64_t kmer)
+                {
+                    entries_.push_back(entry{kmer, offset});
+                });
+        std::sort(entries_.begin(), entries_.end());
+    }
+
+    // Calls f(offset, kmer) for every minimizer of seq, in order of offset.
+    template<ByteBuffer B, typename F>
+    void for_each_minimizer(const sequence_buffer<B>& seq, F f) const
+    {
+        const std::int64_t len = seq.size();
+        const std::uint64_t mask = k_ == word_bases ? ~0ULL : (1ULL << (2 * k_)) - 1;
+        std::deque<minimizer> window; // candidates of the current window, increasing hashes
+        std::uint64_t kmer = 0;
+        std::int64_t last = -1;
+
+        const auto& bytes = seq.buffer();
+        for (std::int64_t i = 0; i < len; ++i)
+        {
+            auto shift = (packed_size::value - 1 - (i % packed_size::value)) * 2;
+            auto b = static_cast<std::uint64_t>((bytes[i / packed_size::value] >> shift) & std::byte{0x3});
+            kmer = ((kmer << 2) | b) & mask;
+
+            std::int64_t start = i - k_ + 1; // offset of the k-mer ending at i
+            if (start < 0)
+                continue;
+
+            std::uint64_t h = hash(kmer);
+            while (!window.empty() && window.back().hash > h)
+                window.pop_back();
+            window.push_back(minimizer{start, h, kmer});
+            if (window.front().offset <= start - static_cast<std::int64_t>(w_))
+                window.pop_front();
+
+            // A sequence shorter than one window still gets its smallest k-mer.
+            if (start >= static_cast<std::int64_t>(w_) - 1 || i == len - 1)
+            {
+                const minimizer& m = window.front();
+                if (m.offset != last)
+                {
+                    f(m.offset, m.kmer);
+                    last = m.offset;
+                }
+            }
+        }
+    }
+
+    // Offsets of every indexed occurrence of kmer.
+    std::vector<std::int64_t> find(std::uint64_t kmer) const
+    {
+        std::vector<std::int64_t> offsets;
+        auto range = std::equal_range(entries_.begin(), entries_.end(), entry{kmer, 0},
+                [](const entry& a, const entry& b) { return a.kmer < b.kmer; });
+        for (auto it = range.first; it != range.second; ++it)
+            offsets.push_back(it->offset);
+        return offsets;
+    }
+
+    // Where query may start in the indexed helix, best first. Every minimizer of the query votes
+    // for the offsets it occurs at (less its own offset in the query), minimizers that occur
+    // more than max_occurrences times (repeats) don't vote. Votes less than max_shift apart
+    // are for the same candidate, with an indel in the query between them; the candidate
+    // starts where its vote from furthest up the query puts it.
+    template<ByteBuffer B>
+    std::vector<candidate> candidates(const sequence_buffer<B>& query, std::size_t max_occurrences = 64,
+            std::int64_t max_shift = 32) const
+    {
+        struct vote
+        {
+            std::int64_t diagonal;
+            std::int64_t query_offset;
+        };
+
+        std::vector<vote> votes;
+        for_each_minimizer(query, [&](std::int64_t qoffset, std::uint64_t kmer)
+                {
+                    auto range = std::equal_range(entries_.begin(), entries_.end(), entry{kmer, 0},
+                            [](const entry& a, const entry& b) { return a.kmer < b.kmer; });
+                    if (static_cast<std::size_t>(range.second - range.first) > max_occurrences)
+                        return;
+                    for (auto it = range.first; it != range.second; ++it)
+                        votes.push_back(vote{it->offset - qoffset, qoffset});
+                });
+
+        std::sort(votes.begin(), votes.end(), [](const vote& a, const vote& b)
+                {
+                    return a.diagonal < b.diagonal;
+                });
+
+        std::vector<candidate> result;
+        for (std::size_t i = 0; i < votes.size(); )
+        {
+            std::size_t first = i;
+            const vote* start = &votes[i];
+            for (++i; i < votes.size() && votes[i].diagonal - votes[i - 1].diagonal < max_shift; ++i)
+            {
+                if (votes[i].query_offset < start->query_offset)
+                    start = &votes[i];
+            }
+            result.push_back(candidate{start->diagonal, i - first});
+        }
+
+        std::sort(result.begin(), result.end(), [](const candidate& a, const candidate& b)
+                {
+                    return a.hits > b.hits || (a.hits == b.hits && a.offset < b.offset);
+                });
+        return result;
+    }
+
+    std::uint32_t k() const
+    {
+        return k_;
+    }
+
+    std::uint32_t w() const
+    {
+        return w_;
+    }
+
+    // Length of the indexed helix.
+    std::int64_t length() const
+    {
+        return length_;
+    }
+
+    std::size_t size() const
+    {
+        return entries_.size();
+    }
+
+    // Writes the index in a binary, host endian format: a magic, k, w, the helix length and
+    // the number of entries followed by the sorted entries.
+    void save(std::ostream& out) const
+    {
+        std::uint64_t count = entries_.size();
+        out.write(magic, sizeof(magic));
+        out.write(reinterpret_cast<const char*>(&k_), sizeof(k_));
+        out.write(reinterpret_cast<const char*>(&w_), sizeof(w_));
+        out.write(reinterpret_cast<const char*>(&length_), sizeof(length_));
+        out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        out.write(reinterpret_cast<const char*>(entries_.data()), count * sizeof(entry));
+        if (!out)
+            throw std::runtime_error("Failed to write k-mer index");
+    }
+
+    static kmer_index load(std::istream& in)
+    {
+        char header[sizeof(magic)];
+        in.read(header, sizeof(header));
+        if (!in || std::memcmp(header, magic, sizeof(magic)) != 0)
+            throw std::runtime_error("Not a k-mer index");
+
+        kmer_index index;
+        std::uint64_t count = 0;
+        in.read(reinterpret_cast<char*>(&index.k_), sizeof(index.k_));
+        in.read(reinterpret_cast<char*>(&index.w_), sizeof(index.w_));
+        in.read(reinterpret_cast<char*>(&index.length_), sizeof(index.length_));
+        in.read(reinterpret_cast<char*>(&count), sizeof(count));
+        if (!in || index.k_ == 0 || index.k_ > word_bases || index.w_ == 0)
+            throw std::runtime_error("Corrupt k-mer index header");
+
+        // A corrupt count must not size the index, so it is checked against what is left of
+        // the stream first. Streams that can't tell are read a block at a time instead, the
+        // entries only growing as far as the stream really goes.
+        std::uint64_t available = bytes_left(in);
+        if (count > available / sizeof(entry))
+            throw std::runtime_error("Truncated k-mer index");
+
+        const std::uint64_t block = 1 << 16;
+        for (std::uint64_t read = 0; read < count; read += block)
+        {
+            std::uint64_t n = std::min(block, count - read);
+            index.entries_.resize(read + n);
+            in.read(reinterpret_cast<char*>(index.entries_.data() + read), n * sizeof(entry));
+            if (!in)
+                throw std::runtime_error("Truncated k-mer index");
+        }
+
+        return index;
+    }
+};
+
+} // dna
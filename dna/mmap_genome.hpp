@@ -0,0 +1,309 @@
+#pragma once
+
+#include "packed_sequence.hpp"
+#include "person.hpp"
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace dna {
+
+const std::string GenomeFormatErr = "Not a packed genome file";
+
+static constexpr std::size_t genome_chromosomes = 23;
+
+// Chromosomes start on a multiple of this in the file, so each maps (and faults in) on its own.
+// It is only the file's layout: the system's pages may be larger, see system_page_size().
+static constexpr std::size_t genome_page_size = 4096;
+
+// The size of the pages madvise() works in, which is 16 or 64 KiB on some systems.
+inline std::size_t system_page_size()
+{
+    static const std::size_t size = [] {
+        long page = ::sysconf(_SC_PAGESIZE);
+        return page > 0 ? static_cast<std::size_t>(page) : genome_page_size;
+    }();
+    return size;
+}
+
+// The first page of a packed genome file. Every field is host endian, the bases of each
+// chromosome are packed 4 to a byte like the streams that were written to the file.
+struct genome_header
+{
+    struct chromosome
+    {
+        std::uint64_t offset; // of the first byte in the file
+        std::uint64_t bases;
+    };
+
+    static constexpr char magic_value[8] = {'D', 'N', 'A', 'G', 'E', 'N', 'O', 'M'};
+    static constexpr std::uint32_t current_version = 1;
+
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t count;
+    chromosome chromosomes[genome_chromosomes];
+};
+
+static_assert(sizeof(genome_header) <= genome_page_size, "genome header must fit in one page");
+
+// Writes every chromosome of person to a packed genome file at path, replacing it. Each
+// stream is read once from the start, only one chunk at a time is held in memory.
+template<typename P> requires Person<P>
+void write_genome(P& person, const std::string& path)
+{
+    if (person.chromosomes() != genome_chromosomes)
+        throw std::invalid_argument("A packed genome holds exactly 23 chromosomes");
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+        throw std::system_error(errno, std::generic_category(), "Failed to create " + path);
+
+    genome_header header{};
+    std::memcpy(header.magic, genome_header::magic_value, sizeof(header.magic));
+    header.version = genome_header::current_version;
+    header.count = genome_chromosomes;
+
+    std::uint64_t pos = genome_page_size;
+    for (std::size_t i = 0; i < genome_chromosomes; ++i)
+    {
+        auto helix = person.chromosome(i);
+        helix.seek(0);
+
+        pos = (pos + genome_page_size - 1) / genome_page_size * genome_page_size;
+        out.seekp(pos);
+        header.chromosomes[i].offset = pos;
+
+        // Chunks need not end on a byte, a partial last byte is carried into the next chunk.
+        std::uint64_t bases = 0;
+        packed_sequence pending;
+        for (auto buf = helix.read(); buf.size() > 0; buf = helix.read())
+        {
+            pending.append(buf);
+            std::size_t whole = pending.size() / packed_size::value;
+            out.write(reinterpret_cast<const char*>(pending.bytes().data()), whole);
+            bases += whole * packed_size::value;
+            pending.erase_front(whole * packed_size::value);
+        }
+
+        out.write(reinterpret_cast<const char*>(pending.bytes().data()), pending.bytes().size());
+        bases += pending.size();
+        pos += (bases + packed_size::value - 1) / packed_size::value;
+
+        if (bases != static_cast<std::uint64_t>(helix.size()))
+            throw std::runtime_error("Chromosome " + std::to_string(i) + " ended before its size");
+        header.chromosomes[i].bases = bases;
+        helix.seek(0);
+    }
+
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.flush();
+    if (!out)
+        throw std::system_error(errno, std::generic_category(), "Failed to write " + path);
+}
+
+// A packed genome file mapped read only. Nothing is read up front: pages are faulted in as
+// the chromosomes are read, and dropped by the kernel under memory pressure.
+class mapped_genome
+{
+    const std::byte* data_ = nullptr;
+    std::size_t size_ = 0;
+
+    const genome_header& header() const
+    {
+        return *reinterpret_cast<const genome_header*>(data_);
+    }
+
+    void validate() const
+    {
+        if (size_ < sizeof(genome_header))
+            throw std::runtime_error(GenomeFormatErr);
+
+        const genome_header& h = header();
+        if (std::memcmp(h.magic, genome_header::magic_value, sizeof(h.magic)) != 0
+                || h.version != genome_header::current_version || h.count != genome_chromosomes)
+            throw std::runtime_error(GenomeFormatErr);
+
+        for (auto& c : h.chromosomes)
+        {
+            std::uint64_t bytes = (c.bases + packed_size::value - 1) / packed_size::value;
+            if (c.offset % genome_page_size != 0 || (bytes > 0 && (c.offset > size_ || bytes > size_ - c.offset)))
+                throw std::runtime_error(GenomeFormatErr);
+        }
+    }
+
+public:
+    explicit mapped_genome(const std::string& path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "Failed to open " + path);
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0)
+        {
+            int err = errno;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), "Failed to stat " + path);
+        }
+
+        size_ = static_cast<std::size_t>(st.st_size);
+        void* mapped = size_ == 0 ? MAP_FAILED : ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        int err = errno;
+        ::close(fd); // the mapping keeps the file open
+        if (mapped == MAP_FAILED)
+        {
+            if (size_ == 0)
+                throw std::runtime_error(GenomeFormatErr);
+            throw std::system_error(err, std::generic_category(), "Failed to map " + path);
+        }
+
+        data_ = static_cast<const std::byte*>(mapped);
+        try {
+            validate();
+        } catch (...) {
+            ::munmap(const_cast<std::byte*>(data_), size_);
+            throw;
+        }
+    }
+
+    ~mapped_genome()
+    {
+        ::munmap(const_cast<std::byte*>(data_), size_);
+    }
+
+    mapped_genome(const mapped_genome&) = delete;
+    mapped_genome& operator=(const mapped_genome&) = delete;
+
+    // The packed bytes of a chromosome, straight out of the mapping.
+    byte_span bytes(std::size_t chromosome) const
+    {
+        auto& c = header().chromosomes[chromosome];
+        return byte_span(data_ + c.offset, (c.bases + packed_size::value - 1) / packed_size::value);
+    }
+
+    std::size_t bases(std::size_t chromosome) const
+    {
+        return header().chromosomes[chromosome].bases;
+    }
+};
+
+// A HelixStream over one chromosome of a mapped genome. Every chunk (from read() or
+// read_view()) is a view of the mapped pages, nothing is copied. Chunks stay valid as long as
+// any stream or person of the genome does, not just until the next read.
+class mmap_helix_stream
+{
+    std::shared_ptr<const mapped_genome> genome_;
+    byte_span bytes_;
+    std::size_t size_ = 0;
+    std::size_t pos_ = 0;
+    std::size_t chunk_bases_;
+
+public:
+    static constexpr std::size_t default_chunk_bases = 1 << 20;
+
+    mmap_helix_stream() : chunk_bases_(default_chunk_bases) {}
+
+    mmap_helix_stream(std::shared_ptr<const mapped_genome> genome, std::size_t chromosome,
+            std::size_t chunk_bases = default_chunk_bases)
+        : genome_(std::move(genome)), bytes_(genome_->bytes(chromosome)), size_(genome_->bases(chromosome)),
+          chunk_bases_(std::max(chunk_bases - chunk_bases % packed_size::value, packed_size::value))
+    {}
+
+    // offset is in bases, reads can only start on a byte so a mid byte offset is rounded down
+    // (apart from the end of the helix)
+    void seek(long offset)
+    {
+        auto bases = std::min(static_cast<std::size_t>(std::max(offset, 0L)), size_);
+        pos_ = bases == size_ ? size_ : bases - bases % packed_size::value;
+    }
+
+    long size() const
+    {
+        return static_cast<long>(size_);
+    }
+
+    sequence_buffer<byte_span> read()
+    {
+        return read_bases(chunk_bases_);
+    }
+
+    sequence_buffer<byte_span> read_view(std::size_t max_bytes)
+    {
+        return read_bases(max_bytes * packed_size::value);
+    }
+
+    // The whole chromosome, straight from the mapped pages.
+    sequence_buffer<byte_span> whole_view() const
+    {
+        return sequence_buffer<byte_span>(bytes_, size_);
+    }
+
+    // Asks the kernel to start reading the pages holding length bases from offset.
+    void prefetch(long offset, long length)
+    {
+        auto first = std::min(static_cast<std::size_t>(std::max(offset, 0L)) / packed_size::value, bytes_.size());
+        auto last = std::min((static_cast<std::size_t>(std::max(offset + length, 0L)) + packed_size::value - 1)
+                / packed_size::value, bytes_.size());
+        if (first >= last)
+            return;
+
+        // madvise wants a page aligned address, and the chromosome is only aligned to the file's
+        // pages, so round the address itself down to the system's
+        auto page = system_page_size();
+        auto address = reinterpret_cast<std::uintptr_t>(bytes_.data() + first);
+        auto start = address - address % page;
+        ::madvise(reinterpret_cast<void*>(start), reinterpret_cast<std::uintptr_t>(bytes_.data() + last) - start,
+                MADV_WILLNEED);
+    }
+
+private:
+    sequence_buffer<byte_span> read_bases(std::size_t max_bases)
+    {
+        auto count = std::min(max_bases, size_ - pos_);
+        if (count == 0)
+            return sequence_buffer<byte_span>(byte_span(), 0);
+
+        auto from = pos_;
+        pos_ += count;
+        return sequence_buffer<byte_span>(byte_span(bytes_.data() + from / packed_size::value,
+                (count + packed_size::value - 1) / packed_size::value), count);
+    }
+};
+
+// A Person backed by a packed genome file. Copies share the mapping.
+class mmap_person
+{
+    std::shared_ptr<const mapped_genome> genome_;
+    std::size_t chunk_bases_;
+
+public:
+    explicit mmap_person(const std::string& path, std::size_t chunk_bases = mmap_helix_stream::default_chunk_bases)
+        : genome_(std::make_shared<const mapped_genome>(path)), chunk_bases_(chunk_bases)
+    {}
+
+    mmap_helix_stream chromosome(std::size_t chromosome_index) const
+    {
+        if (chromosome_index >= genome_chromosomes)
+            throw std::invalid_argument("index is out of range for the number of chromosomes available");
+
+        return mmap_helix_stream(genome_, chromosome_index, chunk_bases_);
+    }
+
+    constexpr std::size_t chromosomes() const
+    {
+        return genome_chromosomes;
+    }
+};
+
+} // dna
@@ -0,0 +1,400 @@
+#pragma once
+
+#include "compact_result.hpp"
+#include "sequence_aligner.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace dna {
+
+const std::string MutationFileErr = "Not a mutation file";
+
+// What the index of a mutation file records about one block: whose mutations it holds, the
+// range they cover on each helix (for skipping blocks that can't match a query) and where its
+// columns are in the file. A result with more than block_rows mutations is split over
+// consecutive blocks, each carrying the result's score and error.
+struct mutation_block
+{
+    std::uint64_t person = 0;
+    std::uint32_t chromosome = 0;
+    std::uint32_t count = 0;
+    int64_t min_helix1 = 0; // start of the first mutation on helix 1
+    int64_t max_helix1 = 0; // end of the last
+    int64_t min_helix2 = 0;
+    int64_t max_helix2 = 0;
+    double similarity_score = 0;
+    result_error error = result_error::none;
+    std::string message; // for result_error::other
+    std::uint64_t offset = 0; // of the columns in the file
+    std::uint32_t column_bytes[4] = {}; // helix1 offset, helix1 length, helix2 offset, helix2 length
+
+    // True if a mutation in this block may overlap [offset, offset + length) on helix 1.
+    bool may_overlap(location region) const
+    {
+        return count > 0 && min_helix1 < region.offset + std::max<int64_t>(region.length, 1)
+            && max_helix1 >= region.offset;
+    }
+};
+
+namespace detail {
+
+template<typename T>
+void write_value(std::ostream& out, const T& value)
+{
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template<typename T>
+T read_value(std::istream& in)
+{
+    T value;
+    in.read(reinterpret_cast<char*>(&value), sizeof(value));
+    if (!in)
+        throw std::runtime_error(MutationFileErr);
+    return value;
+}
+
+} // detail
+
+// Writes alignment results to a columnar mutation file as they complete. The file is a magic,
+// then blocks of four columns (helix 1 offset, helix 1 length, helix 2 offset, helix 2
+// length; offsets zigzag delta varints, lengths varints), then an index of every block and a
+// footer pointing at the index. Only the blocks need to be written while results come in,
+// the index is written by finish().
+//
+// Results may be written from several threads at once (e.g. from the on_result callback of a
+// cohort comparison).
+class mutation_file_writer
+{
+    static constexpr char magic[8] = {'D', 'N', 'A', 'M', 'U', 'T', 'S', '1'};
+
+    std::ostream& out_;
+    std::size_t block_rows_;
+    std::vector<mutation_block> blocks_;
+    std::vector<std::byte> columns_[4];
+    std::uint64_t pos_;
+    bool finished_ = false;
+    std::mutex mutex_;
+
+    static void append_varint(std::vector<std::byte>& column, std::uint64_t value)
+    {
+        std::byte buf[10]; // the longest varint
+        std::byte* end = buf;
+        detail::put_varint(end, value);
+        column.insert(column.end(), buf, end);
+    }
+
+    void write_block(mutation_block block, const mutation* muts)
+    {
+        const std::size_t count = block.count;
+        if (count > 0)
+        {
+            block.min_helix1 = block.min_helix2 = std::numeric_limits<int64_t>::max();
+            block.max_helix1 = block.max_helix2 = std::numeric_limits<int64_t>::min();
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                block.min_helix1 = std::min(block.min_helix1, muts[i].helix1.offset);
+                block.max_helix1 = std::max(block.max_helix1, muts[i].helix1.offset + muts[i].helix1.length);
+                block.min_helix2 = std::min(block.min_helix2, muts[i].helix2.offset);
+                block.max_helix2 = std::max(block.max_helix2, muts[i].helix2.offset + muts[i].helix2.length);
+            }
+        }
+
+        for (auto& column : columns_)
+            column.clear();
+        int64_t previous1 = 0, previous2 = 0;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            append_varint(columns_[0], detail::zigzag(muts[i].helix1.offset - previous1));
+            append_varint(columns_[1], static_cast<std::uint64_t>(muts[i].helix1.length));
+            append_varint(columns_[2], detail::zigzag(muts[i].helix2.offset - previous2));
+            append_varint(columns_[3], static_cast<std::uint64_t>(muts[i].helix2.length));
+            previous1 = muts[i].helix1.offset;
+            previous2 = muts[i].helix2.offset;
+        }
+
+        block.offset = pos_;
+        for (std::size_t c = 0; c < 4; ++c)
+        {
+            block.column_bytes[c] = static_cast<std::uint32_t>(columns_[c].size());
+            out_.write(reinterpret_cast<const char*>(columns_[c].data()), columns_[c].size());
+            pos_ += columns_[c].size();
+        }
+        if (!out_)
+            throw std::runtime_error("Failed to write mutation block");
+        blocks_.push_back(std::move(block));
+    }
+
+public:
+    static constexpr std::size_t default_block_rows = 1 << 16;
+
+    explicit mutation_file_writer(std::ostream& out, std::size_t block_rows = default_block_rows)
+        : out_(out), block_rows_(std::max<std::size_t>(block_rows, 1)), pos_(sizeof(magic))
+    {
+        out_.write(magic, sizeof(magic));
+    }
+
+    mutation_file_writer(const mutation_file_writer&) = delete;
+    mutation_file_writer& operator=(const mutation_file_writer&) = delete;
+
+    // Appends the result of comparing one chromosome of person.
+    void write(std::uint64_t person, std::uint32_t chromosome, const alignment_result& res)
+    {
+        mutation_block block;
+        block.person = person;
+        block.chromosome = chromosome;
+        block.similarity_score = res.similarity_score;
+        block.error = error_code(res.error);
+        if (block.error == result_error::other)
+            block.message = res.error;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (finished_)
+            throw std::logic_error("Mutation file is already finished");
+
+        const std::size_t total = res.mutations.size();
+        std::size_t first = 0;
+        do
+        {
+            block.count = static_cast<std::uint32_t>(std::min(block_rows_, total - first));
+            write_block(block, res.mutations.data() + first);
+            first += block.count;
+        } while (first < total);
+    }
+
+    // Writes the index and footer. Nothing can be written afterwards.
+    void finish()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (finished_)
+            return;
+        finished_ = true;
+
+        std::uint64_t index = pos_;
+        detail::write_value(out_, static_cast<std::uint64_t>(blocks_.size()));
+        for (auto& b : blocks_)
+        {
+            detail::write_value(out_, b.person);
+            detail::write_value(out_, b.chromosome);
+            detail::write_value(out_, b.count);
+            detail::write_value(out_, b.min_helix1);
+            detail::write_value(out_, b.max_helix1);
+            detail::write_value(out_, b.min_helix2);
+            detail::write_value(out_, b.max_helix2);
+            detail::write_value(out_, b.similarity_score);
+            detail::write_value(out_, static_cast<std::uint8_t>(b.error));
+            detail::write_value(out_, static_cast<std::uint32_t>(b.message.size()));
+            out_.write(b.message.data(), b.message.size());
+            detail::write_value(out_, b.offset);
+            for (auto bytes : b.column_bytes)
+                detail::write_value(out_, bytes);
+        }
+
+        detail::write_value(out_, index);
+        out_.write(magic, sizeof(magic));
+        out_.flush();
+        if (!out_)
+            throw std::runtime_error("Failed to write mutation file index");
+    }
+
+    friend class mutation_file_reader;
+};
+
+// Reads a mutation file written by mutation_file_writer. Only the index is read on open,
+// blocks are read when a query can't rule them out from their ranges.
+class mutation_file_reader
+{
+    std::istream& in_;
+    std::vector<mutation_block> blocks_;
+    std::size_t blocks_read_ = 0;
+    std::uint64_t index_ = 0;
+
+    // Index entry bytes besides the message.
+    static constexpr std::uint64_t entry_bytes = 8 + 4 + 4 + 4 * 8 + 8 + 1 + 4 + 8 + 4 * 4;
+
+    // The columns of a block must lie between the magic and the index, and every varint takes
+    // at least one byte. Checked before anything is allocated for the block, so a corrupt
+    // index can't ask for more memory than the file holds.
+    void check(const mutation_block& b) const
+    {
+        std::uint64_t bytes = 0;
+        for (auto column : b.column_bytes)
+        {
+            if (b.count > column)
+                throw std::runtime_error(MutationFileErr);
+            bytes += column;
+        }
+        if (b.offset < sizeof(mutation_file_writer::magic) || b.offset > index_ || bytes > index_ - b.offset)
+            throw std::runtime_error(MutationFileErr);
+    }
+
+    static std::vector<int64_t> decode_column(const std::byte*& p, const std::byte* end, std::size_t count, bool delta)
+    {
+        std::vector<int64_t> values(count);
+        int64_t previous = 0;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (p >= end)
+                throw std::runtime_error(MutationFileErr);
+            std::uint64_t v = detail::get_varint(p);
+            values[i] = delta ? previous + detail::unzigzag(v) : static_cast<int64_t>(v);
+            previous = values[i];
+        }
+        if (p != end)
+            throw std::runtime_error(MutationFileErr);
+        return values;
+    }
+
+public:
+    explicit mutation_file_reader(std::istream& in) : in_(in)
+    {
+        const auto& magic = mutation_file_writer::magic;
+        char header[sizeof(magic)];
+
+        in_.seekg(0, std::ios::end);
+        auto size = static_cast<std::int64_t>(in_.tellg());
+        if (size < static_cast<std::int64_t>(2 * sizeof(magic) + sizeof(std::uint64_t)))
+            throw std::runtime_error(MutationFileErr);
+
+        in_.seekg(0);
+        in_.read(header, sizeof(header));
+        if (!in_ || std::memcmp(header, magic, sizeof(magic)) != 0)
+            throw std::runtime_error(MutationFileErr);
+
+        const auto footer = static_cast<std::uint64_t>(size) - sizeof(magic) - sizeof(std::uint64_t);
+        in_.seekg(footer);
+        index_ = detail::read_value<std::uint64_t>(in_);
+        in_.read(header, sizeof(header));
+        if (!in_ || std::memcmp(header, magic, sizeof(magic)) != 0 || index_ < sizeof(magic)
+                || index_ > footer - sizeof(std::uint64_t))
+            throw std::runtime_error(MutationFileErr);
+
+        in_.seekg(index_);
+        auto count = detail::read_value<std::uint64_t>(in_);
+        std::uint64_t left = footer - index_ - sizeof(std::uint64_t); // index bytes after the count
+        if (count > left / entry_bytes)
+            throw std::runtime_error(MutationFileErr);
+        blocks_.reserve(count);
+        for (std::uint64_t i = 0; i < count; ++i)
+        {
+            mutation_block b;
+            b.person = detail::read_value<std::uint64_t>(in_);
+            b.chromosome = detail::read_value<std::uint32_t>(in_);
+            b.count = detail::read_value<std::uint32_t>(in_);
+            b.min_helix1 = detail::read_value<int64_t>(in_);
+            b.max_helix1 = detail::read_value<int64_t>(in_);
+            b.min_helix2 = detail::read_value<int64_t>(in_);
+            b.max_helix2 = detail::read_value<int64_t>(in_);
+            b.similarity_score = detail::read_value<double>(in_);
+            b.error = static_cast<result_error>(detail::read_value<std::uint8_t>(in_));
+            auto length = detail::read_value<std::uint32_t>(in_);
+            left -= entry_bytes;
+            if (length > left)
+                throw std::runtime_error(MutationFileErr);
+            left -= length;
+            b.message.resize(length);
+            in_.read(&b.message[0], length);
+            b.offset = detail::read_value<std::uint64_t>(in_);
+            for (auto& bytes : b.column_bytes)
+                bytes = detail::read_value<std::uint32_t>(in_);
+            check(b);
+            blocks_.push_back(std::move(b));
+        }
+    }
+
+    const std::vector<mutation_block>& blocks() const
+    {
+        return blocks_;
+    }
+
+    // Number of blocks whose columns have been read.
+    std::size_t blocks_read() const
+    {
+        return blocks_read_;
+    }
+
+    // Reads and decodes the mutations of one block.
+    std::vector<mutation> read_block(const mutation_block& block)
+    {
+        check(block);
+        std::size_t bytes = 0;
+        for (auto b : block.column_bytes)
+            bytes += b;
+
+        std::vector<std::byte> data(bytes);
+        in_.seekg(block.offset);
+        in_.read(reinterpret_cast<char*>(data.data()), bytes);
+        if (!in_)
+            throw std::runtime_error(MutationFileErr);
+        ++blocks_read_;
+
+        const std::byte* p = data.data();
+        std::vector<int64_t> columns[4];
+        for (std::size_t c = 0; c < 4; ++c)
+            columns[c] = decode_column(p, p + block.column_bytes[c], block.count, c % 2 == 0);
+
+        std::vector<mutation> muts;
+        muts.reserve(block.count);
+        for (std::size_t i = 0; i < block.count; ++i)
+            muts.emplace_back(location{columns[0][i], columns[1][i]}, location{columns[2][i], columns[3][i]});
+        return muts;
+    }
+
+    // The whole result written for one chromosome of person. Throws std::out_of_range if
+    // there is none.
+    alignment_result read(std::uint64_t person, std::uint32_t chromosome)
+    {
+        alignment_result res;
+        bool found = false;
+        for (auto& block : blocks_)
+        {
+            if (block.person != person || block.chromosome != chromosome)
+                continue;
+
+            if (!found)
+            {
+                res.similarity_score = block.similarity_score;
+                res.error = std::string(error_message(block.error, block.message));
+                found = true;
+            }
+            if (block.count > 0)
+            {
+                auto muts = read_block(block);
+                res.mutations.insert(res.mutations.end(), muts.begin(), muts.end());
+            }
+        }
+
+        if (!found)
+            throw std::out_of_range("No result for the chromosome");
+        return res;
+    }
+
+    // Calls f(person, mutation) for every mutation of chromosome overlapping region on helix
+    // 1, across every person in the file. Blocks whose range lies outside region aren't read.
+    template<typename F>
+    void scan(std::uint32_t chromosome, location region, F f)
+    {
+        const int64_t end = region.offset + std::max<int64_t>(region.length, 1);
+        for (auto& block : blocks_)
+        {
+            if (block.chromosome != chromosome || !block.may_overlap(region))
+                continue;
+
+            for (auto& mut : read_block(block))
+            {
+                if (mut.helix1.offset < end && mut.helix1.offset + std::max<int64_t>(mut.helix1.length, 1) > region.offset)
+                    f(block.person, mut);
+            }
+        }
+    }
+};
+
+} // dna
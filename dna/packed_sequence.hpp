@@ -0,0 +1,165 @@
+#pragma once
+
+#include <vector>
+#include "sequence_buffer.hpp"
+
+namespace dna
+{
+
+// An owning, growable sequence of bases kept in the same 2 bit packing used on disk (4 bases
+// per byte, first base in the most significant bits). Holding a helix this way costs a
+// quarter of the memory of one byte per base.
+class packed_sequence
+{
+	std::vector<std::byte> bytes_;
+	std::size_t size_ = 0;
+
+	// Number of bases already stored in the last byte (0 when it is full or there is none).
+	std::size_t phase() const noexcept
+	{
+		return size_ % packed_size::value;
+	}
+
+public:
+	packed_sequence() = default;
+
+	explicit packed_sequence(std::size_t capacity)
+	{
+		reserve(capacity);
+	}
+
+	void reserve(std::size_t bases)
+	{
+		bytes_.reserve((bases + packed_size::value - 1) / packed_size::value);
+	}
+
+	void push_back(base value)
+	{
+		if (phase() == 0)
+			bytes_.push_back(std::byte{0});
+
+		auto shift = (packed_size::value - 1 - phase()) * 2;
+		bytes_.back() |= static_cast<std::byte>(value) << shift;
+		++size_;
+	}
+
+	// Appends count (<= 32) bases held in the most significant bits of word.
+	void append_word(std::uint64_t word, std::size_t count)
+	{
+		if (count == 0)
+			return;
+		if (count < word_bases)
+			word &= ~0ULL << ((word_bases - count) * 2);
+
+		if (phase() != 0)
+		{
+			auto fill = std::min(packed_size::value - phase(), count);
+			bytes_.back() |= static_cast<std::byte>(word >> (64 - (packed_size::value - phase()) * 2));
+			word <<= fill * 2;
+			size_ += fill;
+			count -= fill;
+		}
+
+		for (std::size_t i = 0; i < count; i += packed_size::value)
+		{
+			bytes_.push_back(static_cast<std::byte>(word >> 56));
+			word <<= 8;
+		}
+		size_ += count;
+	}
+
+	// Appends count bases of buf starting at from. When both this sequence and from are byte
+	// aligned the packed bytes are copied as they are (with a single memcpy from contiguous
+	// buffers), otherwise the bases are shifted into place a word at a time.
+	template<ByteBuffer T>
+	void append(const sequence_buffer<T>& buf, std::size_t from, std::size_t count)
+	{
+		auto end = std::min(buf.size(), from + count);
+		if (from >= end)
+			return;
+
+		if (phase() == 0 && from % packed_size::value == 0)
+		{
+			auto first = from / packed_size::value;
+			auto bytes = (end - from + packed_size::value - 1) / packed_size::value;
+			if constexpr (ContiguousByteBuffer<T>)
+			{
+				const std::byte* data = buf.buffer().data() + first;
+				bytes_.insert(bytes_.end(), data, data + bytes);
+			} else
+			{
+				for (std::size_t i = 0; i < bytes; ++i)
+					bytes_.push_back(buf.buffer()[first + i]);
+			}
+
+			size_ += end - from;
+			if (phase() != 0) // bases past end share the last byte
+				bytes_.back() &= static_cast<std::byte>(0xff << (8 - phase() * 2));
+			return;
+		}
+
+		for (std::size_t i = from; i < end; i += word_bases)
+			append_word(buf.word_at(i), std::min(word_bases, end - i));
+	}
+
+	// Appends every base of buf.
+	template<ByteBuffer T>
+	void append(const sequence_buffer<T>& buf)
+	{
+		append(buf, 0, buf.size());
+	}
+
+	// Drops the first count bases, shifting the remainder to the front.
+	void erase_front(std::size_t count)
+	{
+		if (count >= size_)
+		{
+			clear();
+			return;
+		}
+
+		packed_sequence rest(size_ - count);
+		rest.append(view(), count, size_ - count);
+		*this = std::move(rest);
+	}
+
+	void clear() noexcept
+	{
+		bytes_.clear();
+		size_ = 0;
+	}
+
+	base at(std::size_t index) const
+	{
+		auto shift = (packed_size::value - 1 - (index % packed_size::value)) * 2;
+		return static_cast<base>((bytes_[index / packed_size::value] >> shift) & std::byte{0x3});
+	}
+
+	base operator[](std::size_t index) const
+	{
+		return at(index);
+	}
+
+	std::size_t size() const noexcept
+	{
+		return size_;
+	}
+
+	bool empty() const noexcept
+	{
+		return size_ == 0;
+	}
+
+	const std::vector<std::byte>& bytes() const noexcept
+	{
+		return bytes_;
+	}
+
+	// A sequence buffer over the packed bytes, valid until the sequence is modified.
+	sequence_buffer<byte_span> view() const noexcept
+	{
+		return sequence_buffer<byte_span>(byte_span(bytes_.data(), bytes_.size()), size_);
+	}
+};
+
+} // dna
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <memory>
+#include "packed_sequence.hpp"
+#include "person.hpp"
+
+namespace dna
+{
+
+// Bytes borrowed per read_view() by the readers below.
+static constexpr std::size_t view_bytes = 1 << 18;
+
+// Reads a whole helix into a packed sequence. Streams that lend views are read straight from
+// their bytes, prefetching the next view before copying the current one.
+template<HelixStream T>
+packed_sequence read_packed(T& helix)
+{
+	packed_sequence seq(helix.size());
+	if constexpr (ChunkViewStream<T>)
+	{
+		long pos = 0;
+		for (auto view = helix.read_view(view_bytes); view.size() > 0; view = helix.read_view(view_bytes))
+		{
+			pos += view.size();
+			helix.prefetch(pos, view_bytes * packed_size::value);
+			seq.append(view);
+		}
+		return seq;
+	}
+
+	while (true)
+	{
+		auto buf = helix.read();
+		if (buf.size() == 0)
+			return seq;
+
+		seq.append(buf);
+	}
+}
+
+// The bases of a whole helix as the aligners take them: a view the stream lent, or a view of a
+// packed copy for streams that can't lend one. Copies of it share the stream or the packed
+// copy that the view is of, so the view stays valid as long as any of them does.
+class helix_bases
+{
+	std::shared_ptr<const void> owner_;
+	sequence_buffer<byte_span> view_;
+
+public:
+	helix_bases() :
+			view_(byte_span(), 0)
+	{ }
+
+	helix_bases(std::shared_ptr<const void> owner, sequence_buffer<byte_span> view) :
+			owner_(std::move(owner)),
+			view_(view)
+	{ }
+
+	explicit helix_bases(packed_sequence seq) :
+			helix_bases()
+	{
+		auto copy = std::make_shared<const packed_sequence>(std::move(seq));
+		view_ = copy->view();
+		owner_ = std::move(copy);
+	}
+
+	const sequence_buffer<byte_span>& view() const noexcept
+	{
+		return view_;
+	}
+
+	std::size_t size() const noexcept
+	{
+		return view_.size();
+	}
+
+	bool empty() const noexcept
+	{
+		return view_.size() == 0;
+	}
+};
+
+// Reads a whole helix for an aligner. Streams that can lend their bases are not copied, only
+// the others are read into a packed sequence.
+template<HelixStream T>
+helix_bases read_helix(T& helix)
+{
+	if constexpr (WholeViewStream<T>)
+	{
+		auto view = helix.whole_view();
+		if (view.size() > 0)
+			return helix_bases(std::make_shared<const T>(helix), view);
+	}
+
+	return helix_bases(read_packed(helix));
+}
+
+// The next chunk of a helix: a view of at most max_bytes bytes from streams that lend them,
+// the next read() from others.
+template<HelixStream T>
+auto next_chunk(T& helix, std::size_t max_bytes)
+{
+	if constexpr (ChunkViewStream<T>)
+		return helix.read_view(std::min(max_bytes, view_bytes));
+	else
+		return helix.read();
+}
+
+// Reads only the length bases at offset from (clamped to the helix) into a packed sequence,
+// seeking straight to them. Streams are read from the byte holding from.
+template<HelixStream T>
+packed_sequence read_packed(T& helix, int64_t from, int64_t length)
+{
+	const int64_t size = helix.size();
+	from = std::min(std::max<int64_t>(from, 0), size);
+	const int64_t end = std::min(from + std::max<int64_t>(length, 0), size);
+
+	int64_t pos = from - from % packed_size::value;
+	prefetch(helix, pos, end - pos);
+	helix.seek(pos);
+
+	packed_sequence seq(end - from);
+	while (pos < end)
+	{
+		auto buf = next_chunk(helix, (end - pos + packed_size::value - 1) / packed_size::value);
+		if (buf.size() == 0)
+			break;
+
+		int64_t skip = std::max<int64_t>(from - pos, 0);
+		int64_t take = std::min<int64_t>(buf.size(), end - pos) - skip;
+		if (take > 0)
+			seq.append(buf, skip, take);
+		pos += buf.size();
+	}
+
+	return seq;
+}
+
+// A HelixStream over a range of a shared, read only packed sequence (or of helix bases an
+// aligner read). Any number of streams can read (possibly overlapping) ranges of the same
+// sequence concurrently, which lets one loaded helix be split into independently alignable
+// pieces.
+class packed_stream
+{
+	helix_bases seq_;
+	std::size_t begin_;
+	std::size_t end_;
+	std::size_t pos_;
+	std::size_t chunk_bases_;
+	packed_sequence chunk_;
+public:
+	static constexpr std::size_t default_chunk_bases = 1 << 16;
+
+	packed_stream() :
+			begin_(0),
+			end_(0),
+			pos_(0),
+			chunk_bases_(default_chunk_bases)
+	{ }
+
+	packed_stream(helix_bases seq, std::size_t begin, std::size_t length,
+			std::size_t chunk_bases = default_chunk_bases) :
+			seq_(std::move(seq)),
+			begin_(std::min(begin, seq_.size())),
+			end_(std::min(begin_ + length, seq_.size())),
+			pos_(begin_),
+			chunk_bases_(chunk_bases)
+	{ }
+
+	explicit packed_stream(helix_bases seq) :
+			packed_stream(seq, 0, seq.size())
+	{ }
+
+	packed_stream(const std::shared_ptr<const packed_sequence>& seq, std::size_t begin, std::size_t length,
+			std::size_t chunk_bases = default_chunk_bases) :
+			packed_stream(helix_bases(seq, seq->view()), begin, length, chunk_bases)
+	{ }
+
+	explicit packed_stream(const std::shared_ptr<const packed_sequence>& seq) :
+			packed_stream(seq, 0, seq->size())
+	{ }
+
+	void seek(long offset)
+	{
+		pos_ = begin_ + std::min(static_cast<std::size_t>(std::max(offset, 0L)), end_ - begin_);
+	}
+
+	long size() const
+	{
+		return static_cast<long>(end_ - begin_);
+	}
+
+	// Byte aligned chunks are views straight into the shared sequence, others are re-packed
+	// into a buffer owned by the stream. Either is valid until the next read.
+	sequence_buffer<byte_span> read()
+	{
+		return read_bases(chunk_bases_);
+	}
+
+	sequence_buffer<byte_span> read_view(std::size_t max_bytes)
+	{
+		return read_bases(max_bytes * packed_size::value);
+	}
+
+	// The range is lent when it starts on a byte, otherwise it has to be re-packed.
+	sequence_buffer<byte_span> whole_view() const
+	{
+		if (begin_ % packed_size::value != 0 || begin_ == end_)
+			return sequence_buffer<byte_span>(byte_span(), 0);
+
+		auto bytes = (end_ - begin_ + packed_size::value - 1) / packed_size::value;
+		return sequence_buffer<byte_span>(
+				byte_span(seq_.view().buffer().data() + begin_ / packed_size::value, bytes), end_ - begin_);
+	}
+
+	// The sequence is already in memory.
+	void prefetch(long, long)
+	{ }
+
+private:
+	sequence_buffer<byte_span> read_bases(std::size_t max_bases)
+	{
+		auto count = std::min(max_bases, end_ - pos_);
+		if (count == 0)
+			return sequence_buffer<byte_span>(byte_span(), 0);
+
+		auto from = pos_;
+		pos_ += count;
+
+		if (from % packed_size::value == 0)
+		{
+			auto bytes = (count + packed_size::value - 1) / packed_size::value;
+			return sequence_buffer<byte_span>(
+					byte_span(seq_.view().buffer().data() + from / packed_size::value, bytes), count);
+		}
+
+		chunk_.clear();
+		chunk_.append(seq_.view(), from, count);
+		return chunk_.view();
+	}
+};
+
+} // dna
@@ -3,11 +3,24 @@
 #include "person.hpp"
 #include "sequence_aligner.hpp"
 #include "thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include <future>
+#include <numeric>
 
 namespace dna {
 
-const std::string ChromoMismatchMFErr = "Cannot match an X with a Y chromosome";
+// Index of the X/Y chromosome.
+static constexpr std::size_t sex_chromosome = 22;
+
+// Detect X/Y chromosome mismatch. A Y chromosome has ~57 million bp and an X
+// chromosome has ~156 million bp. If one chromesome is less then 60% the size
+// of other we can safely say we have a identified an X/Y (or a really corrupt strand).
+inline bool is_xy_mismatch(long size1, long size2)
+{
+    return static_cast<double>(std::min(size1, size2)) / std::max(size1, size2) < .6;
+}
 
 template<typename T>
 concept bool ChromesomeSimliar = requires(T a, T b) {
@@ -23,80 +36,171 @@ concept bool IsPerson = requires(T a) {
 template<HelixStream T>
 class AlignmentForker {
 public:
-    virtual std::future<alignment_result> spawn_alignment(T&& a, T&& b) = 0;
+    using completion = std::function<void(alignment_result&&)>;
+
+    // Starts aligning a and b. on_done is called with the result on whichever thread
+    // finished the alignment, it must not block.
+    virtual void spawn_alignment(T&& a, T&& b, completion on_done) = 0;
+
+    virtual std::future<alignment_result> spawn_alignment(T&& a, T&& b)
+    {
+        auto promise = std::make_shared<std::promise<alignment_result>>();
+        auto result = promise->get_future();
+        spawn_alignment(std::move(a), std::move(b), [promise](alignment_result&& res)
+                {
+                    promise->set_value(std::move(res));
+                });
+        return result;
+    }
+};
+
+// Decides the order the chromosomes of a comparison are handed to the forker. sizes holds the
+// length of the longer helix of every chromosome, the returned order must list every
+// chromosome index exactly once.
+class scheduling_policy {
+public:
+    virtual ~scheduling_policy() {}
+    virtual std::vector<std::size_t> order(const std::vector<long>& sizes) const = 0;
+};
+
+// Submits chromosomes in index order.
+class index_order_policy : public scheduling_policy {
+public:
+    std::vector<std::size_t> order(const std::vector<long>& sizes) const override
+    {
+        std::vector<std::size_t> indexes(sizes.size());
+        std::iota(indexes.begin(), indexes.end(), 0);
+        return indexes;
+    }
+
+    static const index_order_policy& instance()
+    {
+        static const index_order_policy policy;
+        return policy;
+    }
 };
 
-// Analyize two pairs of dna
+// Longest processing time first. Alignment time grows with chromosome length and chromosome
+// 1 is ~5x the size of chromosome 21, so when the big ones are submitted last a comparison
+// ends with one long chromosome running alone while the other workers idle. Starting the
+// longest first lets the short ones fill in the gaps at the end.
+class largest_first_policy : public scheduling_policy {
+public:
+    std::vector<std::size_t> order(const std::vector<long>& sizes) const override
+    {
+        std::vector<std::size_t> indexes = index_order_policy::instance().order(sizes);
+        std::stable_sort(indexes.begin(), indexes.end(), [&sizes](std::size_t a, std::size_t b)
+                {
+                    return sizes[a] > sizes[b];
+                });
+        return indexes;
+    }
+
+    static const largest_first_policy& instance()
+    {
+        static const largest_first_policy policy;
+        return policy;
+    }
+};
+
+// Analyize two pairs of dna. Chromosomes are handed to the forker whole, telomeres included,
+// the same as cohort_aligner aligns them.
 template <HelixStream T>
 class pairwise_aligner {
-    using future_results = std::vector<std::future<alignment_result>>;
-
     AlignmentForker<T>& forker_;
-    thread_pool& pool_;
+    const scheduling_policy& schedule_;
 
-    class futures_closure
+    // Collects the chromosome results of one comparison. Every finished chromosome stores its
+    // result and the last one to finish fulfils the promise, so no thread ever waits on the
+    // chromosome futures.
+    class comparison_state
     {
-        future_results futures_;
+        std::vector<alignment_result> results_;
+        std::atomic<std::size_t> pending_;
+        std::promise<std::vector<alignment_result>> promise_;
+
+        void release()
+        {
+            if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                promise_.set_value(std::move(results_));
+        }
+
     public:
-        explicit futures_closure(future_results&& futures) : futures_(std::move(futures)) {}
+        // pending_ starts at 1 so the promise can't be fulfilled before all chromosomes
+        // have been submitted.
+        explicit comparison_state(std::size_t chromosomes) : results_(chromosomes), pending_(1) {}
 
-        std::vector<alignment_result> wait_for_all()
+        std::future<std::vector<alignment_result>> get_future()
         {
-            std::vector<alignment_result> results;
-            results.reserve(futures_.size());
+            return promise_.get_future();
+        }
 
-            for (size_t i = 0; i < futures_.size(); ++i) {
-                results.push_back(std::move(futures_[i].get()));
-            }
+        // Registers a chromosome that will be completed later.
+        void add()
+        {
+            pending_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void complete(std::size_t index, alignment_result&& result)
+        {
+            results_[index] = std::move(result);
+            release();
+        }
 
-            return results;
+        // Called once every chromosome has been added.
+        void seal()
+        {
+            release();
         }
     };
 
 public:
-    explicit pairwise_aligner(thread_pool& pool, AlignmentForker<T>& forker)
-        : forker_(forker), pool_(pool) {};
+    explicit pairwise_aligner(AlignmentForker<T>& forker,
+            const scheduling_policy& schedule = largest_first_policy::instance())
+        : forker_(forker), schedule_(schedule) {};
 
     // TODO: Use future build in error?
     // TODO: use constraints to enforce person chromo count of 23
     template <typename P> requires (Person<P> && IsPerson<P>)
     std::future<std::vector<alignment_result>> analyze_people_async(P& p1, P& p2){
-        future_results futures;
-        futures.reserve(p1.chromosomes());
+        const std::size_t count = p1.chromosomes();
+        auto state = std::make_shared<comparison_state>(count);
+        auto results = state->get_future();
+
+        std::vector<T> helix1, helix2;
+        std::vector<long> sizes;
+        helix1.reserve(count);
+        helix2.reserve(count);
+        sizes.reserve(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            helix1.push_back(p1.chromosome(i));
+            helix2.push_back(p2.chromosome(i));
+            sizes.push_back(std::max(helix1[i].size(), helix2[i].size()));
+        }
 
-        for (std::size_t i = 0; i < p1.chromosomes(); ++i)
+        for (std::size_t index : schedule_.order(sizes))
         {
-            T h1 = std::move(p1.chromosome(i));
-            T h2 = std::move(p2.chromosome(i));
+            T& h1 = helix1[index];
+            T& h2 = helix2[index];
+            state->add();
 
-            if (i == 22)
+            if (index == sex_chromosome && is_xy_mismatch(h1.size(), h2.size()))
             {
-                // Detect X/Y chromosome mismatch. A Y chromosome has ~57 million bp and an X
-                // chromosome has ~156 million bp. If one chromesome is less then 60% the size
-                // of other we can safely say we have a identified an X/Y (or a really corrupt strand).
-                if (static_cast<double>(std::min(h1.size(), h2.size())) / std::max(h1.size(), h2.size()) < .6)
-                {
-                    std::promise<alignment_result> p;
-                    alignment_result result;
-                    result.error = std::string(ChromoMismatchMFErr);
-                    p.set_value(result);
-                    futures.push_back(std::move(p.get_future()));
-                    break;
-                }
+                alignment_result result;
+                result.error = std::string(ChromoMismatchMFErr);
+                state->complete(index, std::move(result));
+                continue;
             }
 
-            std::future<alignment_result> my_future = forker_.spawn_alignment(
-                    std::move(h1), std::move(h2));
-            futures.push_back(std::move(my_future));
+            forker_.spawn_alignment(std::move(h1), std::move(h2), [state, index](alignment_result&& res)
+                    {
+                        state->complete(index, std::move(res));
+                    });
         }
 
-        auto wait_main = [](futures_closure* closure)
-                {
-                    auto results = std::move(closure->wait_for_all());
-                    delete closure;
-                    return results;
-                };
-        return pool_.enqueue(wait_main, new futures_closure(std::move(futures)));
+        state->seal();
+        return results;
     }
 };
 
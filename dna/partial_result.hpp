@@ -0,0 +1,157 @@
+#pragma once
+
+#include "anchor_chain.hpp"
+#include "sequence_aligner.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace dna {
+
+// The alignment of one segment of a helix pair, in a form that can be combined with the
+// alignments of the neighbouring segments. merge() is associative and commutative and the
+// empty result is its identity, so segment results can be reduced by any number of workers in
+// any grouping and order, giving the same result as aligning the covered ranges whole.
+//
+// Mutation offsets are absolute (relative to the start of the helixes, not of the segment).
+// A mutation that reaches the end of a segment on both helixes is open: the difference may
+// continue into the next segment, where it shows up as a mutation starting at the very start.
+// merge() joins the two halves back into one mutation.
+struct partial_result
+{
+    location helix1; // range of each helix the result covers
+    location helix2;
+    int64_t matched = 0; // bases aligned to an equal base
+    int64_t substituted = 0; // bases aligned to a different base
+    int64_t inserted = 0; // bases only present in helix 2
+    int64_t deleted = 0; // bases only present in helix 1
+    std::vector<mutation> mutations;
+    std::string error; // the first error of the covered segments, in helix order
+
+    partial_result() = default;
+
+    // The result of aligning segment seg, with res offsets relative to the segment.
+    partial_result(const segment& seg, alignment_result&& res)
+        : helix1(seg.helix1), helix2(seg.helix2), error(std::move(res.error))
+    {
+        matched = seg.helix1.length;
+        mutations.reserve(res.mutations.size());
+        for (auto& mut : res.mutations)
+        {
+            mutations.emplace_back(location{mut.helix1.offset + seg.helix1.offset, mut.helix1.length},
+                    location{mut.helix2.offset + seg.helix2.offset, mut.helix2.length});
+            tally(mutations.back(), 1);
+        }
+    }
+
+    // Adds (sign 1) or removes (sign -1) the bases of a mutation from the counts.
+    void tally(const mutation& mut, int64_t sign)
+    {
+        int64_t common = std::min(mut.helix1.length, mut.helix2.length);
+        matched -= sign * mut.helix1.length;
+        substituted += sign * common;
+        deleted += sign * (mut.helix1.length - common);
+        inserted += sign * (mut.helix2.length - common);
+    }
+
+    // True if nothing has been covered yet (the identity of merge()).
+    bool empty() const
+    {
+        return helix1.length == 0 && helix2.length == 0 && error.empty();
+    }
+
+    // True if the last mutation may continue past the end of the covered ranges.
+    bool open_back() const
+    {
+        return !mutations.empty()
+            && mutations.back().helix1.offset + mutations.back().helix1.length == helix1.offset + helix1.length
+            && mutations.back().helix2.offset + mutations.back().helix2.length == helix2.offset + helix2.length;
+    }
+
+    // True if the first mutation may have started before the covered ranges.
+    bool open_front() const
+    {
+        return !mutations.empty() && mutations.front().helix1.offset == helix1.offset
+            && mutations.front().helix2.offset == helix2.offset;
+    }
+
+    // The result for the whole helixes, once every segment has been merged in. The score is
+    // computed the same way the aligners compute it for a whole helix pair.
+    alignment_result to_result() const
+    {
+        alignment_result res;
+        if (!error.empty())
+        {
+            res.error = error;
+            return res;
+        }
+
+        int64_t mutated1 = 0;
+        for (auto& mut : mutations)
+            mutated1 += mut.helix1.length;
+        int64_t longest = std::max(helix1.length, helix2.length);
+        res.similarity_score = longest == 0 ? 1 : 1 - static_cast<double>(mutated1) / longest;
+        res.mutations = mutations;
+        return res;
+    }
+};
+
+// Combines the results of two adjacent segments (in either order). Throws
+// std::invalid_argument if they don't meet on both helixes.
+inline partial_result merge(partial_result a, partial_result b)
+{
+    if (a.empty())
+        return b;
+    if (b.empty())
+        return a;
+
+    if (b.helix1.offset < a.helix1.offset || (b.helix1.offset == a.helix1.offset && b.helix2.offset < a.helix2.offset))
+        std::swap(a, b);
+    if (a.helix1.offset + a.helix1.length != b.helix1.offset || a.helix2.offset + a.helix2.length != b.helix2.offset)
+        throw std::invalid_argument("Partial results are not of adjacent segments");
+
+    partial_result merged;
+    merged.helix1 = location{a.helix1.offset, a.helix1.length + b.helix1.length};
+    merged.helix2 = location{a.helix2.offset, a.helix2.length + b.helix2.length};
+    merged.matched = a.matched + b.matched;
+    merged.substituted = a.substituted + b.substituted;
+    merged.inserted = a.inserted + b.inserted;
+    merged.deleted = a.deleted + b.deleted;
+    merged.error = !a.error.empty() ? std::move(a.error) : std::move(b.error);
+
+    bool join = a.open_back() && b.open_front();
+    merged.mutations = std::move(a.mutations);
+    merged.mutations.reserve(merged.mutations.size() + b.mutations.size());
+    auto rest = b.mutations.begin();
+    if (join)
+    {
+        // How the bases of a mutation split by the cut pair up depends on the whole mutation.
+        mutation& last = merged.mutations.back();
+        merged.tally(last, -1);
+        merged.tally(*rest, -1);
+        last.helix1.length += rest->helix1.length;
+        last.helix2.length += rest->helix2.length;
+        merged.tally(last, 1);
+        ++rest;
+    }
+    merged.mutations.insert(merged.mutations.end(), rest, b.mutations.end());
+    return merged;
+}
+
+// Merges any number of adjacent segment results, in whatever order they arrived.
+inline partial_result merge_all(std::vector<partial_result> parts)
+{
+    std::sort(parts.begin(), parts.end(), [](const partial_result& a, const partial_result& b)
+            {
+                return a.helix1.offset < b.helix1.offset
+                    || (a.helix1.offset == b.helix1.offset && a.helix2.offset < b.helix2.offset);
+            });
+
+    partial_result merged;
+    for (auto& part : parts)
+        merged = merge(std::move(merged), std::move(part));
+    return merged;
+}
+
+} // dna
@@ -12,6 +12,32 @@ concept bool HelixStream = requires(T a) {
 	{ a.size() } -> std::size_t;
 };
 
+// A HelixStream that can also lend its packed bytes without copying them.
+// read_view(max_bytes) returns up to max_bytes bytes from the current offset, valid until the
+// next call on the stream, and prefetch(offset, length) hints that those bases will be read
+// soon so fetching them can overlap with processing the current chunk.
+template<typename T>
+concept bool ChunkViewStream = HelixStream<T> && requires(T a) {
+	{ a.read_view(1UL) } -> sequence_buffer<byte_span>
+	{ a.prefetch(0L, 0L) };
+};
+
+// A ChunkViewStream that can lend all of its bases at once. whole_view() returns a view of the
+// whole helix, valid as long as the stream or any copy of it is, or an empty view if this
+// stream can't lend one (its bases then have to be read).
+template<typename T>
+concept bool WholeViewStream = ChunkViewStream<T> && requires(T a) {
+	{ a.whole_view() } -> sequence_buffer<byte_span>
+};
+
+// Passes a prefetch hint on to streams that take them.
+template<HelixStream T>
+void prefetch(T& helix, long offset, long length)
+{
+	if constexpr (ChunkViewStream<T>)
+		helix.prefetch(offset, length);
+}
+
 template<typename T>
 concept bool Person = requires(T a) {
 	{ a.chromosome(1) } -> HelixStream
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "kmer_index.hpp"
+#include "packed_stream.hpp"
+#include "person.hpp"
+#include "sequence_aligner.hpp"
+#include "telomere.hpp"
+#include "thread_pool.hpp"
+#include <future>
+#include <memory>
+#include <stdexcept>
+
+namespace dna {
+
+const std::string TelomereAnchorErr = "Cannot find the telomere the region is relative to";
+const std::string RegionOutOfRangeErr = "Region is outside of the chromosome";
+const std::string KmerIndexMismatchErr = "k-mer index is not of the chromosome being compared";
+
+// Compares one region of a chromosome (e.g. a mutation found by a whole chromosome alignment)
+// across other people. Region offsets count from the end of the front telomere: telomeres
+// differ in length between people, so that is the first position every person agrees on.
+//
+// Only the front telomere and the region (plus margin bases either side, to absorb indels
+// before the region) are read from each person, all other bases are skipped with seek(). With
+// a k-mer index of a person's chromosome the region is instead read from where the index
+// places it, so indels before the region larger than the margin don't matter. When given a
+// pool people are compared on it concurrently. compare() may itself run on that pool, it waits
+// for the people through thread_pool::wait, which keeps the worker running queued tasks.
+class region_aligner
+{
+    const sequence_aligner<packed_stream>& aligner_;
+    thread_pool* pool_;
+    int64_t margin_;
+    std::size_t telomere_window_;
+
+    struct reference_region
+    {
+        std::shared_ptr<const packed_sequence> bases; // region plus margins
+        location region;
+        int64_t lead; // margin bases before the region
+    };
+
+    template<HelixStream T>
+    alignment_result compare_one(const reference_region& ref, T& helix, const kmer_index* index) const
+    {
+        alignment_result res;
+        int64_t front = telomere_front(helix, telomere_window_);
+        if (front == 0 || front == helix.size())
+        {
+            res.error = TelomereAnchorErr;
+            return res;
+        }
+
+        int64_t start = front + ref.region.offset - ref.lead;
+        if (index != nullptr)
+        {
+            if (index->length() != helix.size())
+            {
+                res.error = KmerIndexMismatchErr;
+                return res;
+            }
+
+            // Falls back to the telomere offset when no minimizer of the region is found.
+            auto candidates = index->candidates(ref.bases->view());
+            if (!candidates.empty())
+                start = std::max<int64_t>(candidates.front().offset, 0);
+        }
+
+        if (start + ref.lead >= helix.size())
+        {
+            res.error = RegionOutOfRangeErr;
+            return res;
+        }
+
+        auto bases = std::make_shared<const packed_sequence>(read_packed(helix,
+                start, static_cast<int64_t>(ref.bases->size())));
+        packed_stream h1(ref.bases), h2(bases);
+        alignment_result window = aligner_.align(h1, h2);
+        if (!window.error.empty())
+            return window;
+
+        // Back to offsets from the telomeres, keeping what touches the region.
+        const int64_t shift = ref.region.offset - ref.lead;
+        const int64_t shift2 = start - front;
+        const int64_t region_end = ref.region.offset + ref.region.length;
+        double total_muts = 0;
+        for (auto& mut : window.mutations)
+        {
+            int64_t offset1 = mut.helix1.offset + shift;
+            if (offset1 + mut.helix1.length <= ref.region.offset || offset1 >= region_end)
+                continue;
+
+            total_muts += std::min(offset1 + mut.helix1.length, region_end) - std::max(offset1, ref.region.offset);
+            res.mutations.emplace_back(location{offset1, mut.helix1.length},
+                    location{mut.helix2.offset + shift2, mut.helix2.length});
+        }
+
+        res.similarity_score = 1 - total_muts / std::max<int64_t>(ref.region.length, 1);
+        return res;
+    }
+
+public:
+    explicit region_aligner(const sequence_aligner<packed_stream>& aligner, thread_pool* pool = nullptr,
+            int64_t margin = 1 << 10, std::size_t telomere_window = 1 << 14)
+        : aligner_(aligner), pool_(pool), margin_(margin), telomere_window_(telomere_window)
+    {}
+
+    // Compares region of person's chromosome with the same region in each of others. Returns
+    // one result per person in others, helix 1 offsets count from the end of person's front
+    // telomere and helix 2 offsets from the end of the other person's. A person whose front
+    // telomere can't be found (or whose chromosome ends before the region) gets an error.
+    // Throws std::invalid_argument if the region can't be found in person's chromosome.
+    template<typename P, typename R> requires Person<P>
+    std::vector<alignment_result> compare(P& person, std::size_t chromosome, location region, R& others) const
+    {
+        return compare(person, chromosome, region, others, std::vector<std::shared_ptr<const kmer_index>>());
+    }
+
+    // As above, with indexes[i] the k-mer index of the chromosome of the i-th person in others
+    // (or null for a person that has none, as does any person past the end of indexes).
+    template<typename P, typename R> requires Person<P>
+    std::vector<alignment_result> compare(P& person, std::size_t chromosome, location region, R& others,
+            const std::vector<std::shared_ptr<const kmer_index>>& indexes) const
+    {
+        auto helix = person.chromosome(chromosome);
+        int64_t front = telomere_front(helix, telomere_window_);
+        if (front == 0 || front == helix.size())
+            throw std::invalid_argument(TelomereAnchorErr);
+        if (region.offset < 0 || region.length <= 0 || front + region.offset + region.length > helix.size())
+            throw std::invalid_argument(RegionOutOfRangeErr);
+
+        reference_region ref;
+        ref.region = region;
+        ref.lead = std::min(margin_, region.offset);
+        ref.bases = std::make_shared<const packed_sequence>(read_packed(helix,
+                front + region.offset - ref.lead, ref.lead + region.length + margin_));
+
+        auto compare_person = [this, &ref, &indexes, chromosome](P& other, std::size_t i)
+        {
+            alignment_result res;
+            try {
+                auto other_helix = other.chromosome(chromosome);
+                res = compare_one(ref, other_helix, i < indexes.size() ? indexes[i].get() : nullptr);
+            } catch (const std::exception& e) {
+                res.error = e.what();
+            }
+            return res;
+        };
+
+        std::vector<alignment_result> results;
+        std::size_t i = 0;
+        if (pool_ != nullptr)
+        {
+            std::vector<std::future<alignment_result>> futures;
+            for (P& other : others)
+            {
+                futures.push_back(pool_->enqueue([&compare_person, &other, i] { return compare_person(other, i); }));
+                ++i;
+            }
+            for (auto& f : futures)
+                results.push_back(pool_->wait(f));
+        } else
+        {
+            for (P& other : others)
+                results.push_back(compare_person(other, i++));
+        }
+
+        return results;
+    }
+};
+
+} // dna
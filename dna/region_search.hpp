@@ -0,0 +1,211 @@
+#pragma once
+
+#include "packed_sequence.hpp"
+#include "person.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace dna {
+
+// Where a query ends in a helix and how many edits the best alignment ending there takes.
+struct approximate_match
+{
+    int64_t end; // one past the last base of the match
+    int64_t distance;
+
+    bool operator==(const approximate_match& m) const
+    {
+        return end == m.end && distance == m.distance;
+    }
+};
+
+// Finds every place a query (say, a region of another person's helix) occurs in a helix with
+// at most max_edits substitutions, insertions and deletions, in one pass over the helix.
+//
+// This is Myers' bit-vector edit distance, in Hyyrö's form for queries longer than a word:
+// the column of the edit distance matrix for a helix base is kept as vertical deltas, 64
+// query bases per word, so a whole word of the column is advanced by a handful of word
+// operations. Only the blocks of the column that can still hold a distance of max_edits or
+// less are computed (Ukkonen's cut off), so a query that doesn't occur costs about one block
+// per base whatever its length.
+//
+// Matches are reported by their end. A match of distance d starts between end - length() - d
+// and end - length() + d, and the ends next to a good match are usually matches as well.
+class region_search
+{
+    using word = std::uint64_t;
+    static constexpr int64_t block_bases = 64;
+
+    int64_t length_;
+    int64_t max_edits_;
+    std::size_t blocks_;
+    std::array<std::vector<word>, 4> peq_; // per base, the query bases equal to it
+
+    // The current column.
+    std::vector<word> pv_; // vertical deltas of +1
+    std::vector<word> mv_; // vertical deltas of -1
+    std::vector<int64_t> score_; // distance at the last row of each block
+    std::size_t last_ = 0; // last block computed
+    int64_t offset_ = 0; // helix bases seen
+
+    // Advances one block of the column by a helix base. hin is the horizontal delta entering
+    // the top of the block, the delta leaving its bottom is returned.
+    static int advance(word& pv, word& mv, word eq, int hin)
+    {
+        word hin_neg = hin < 0 ? 1 : 0;
+        word xv = eq | mv;
+        eq |= hin_neg;
+        word xh = (((eq & pv) + pv) ^ pv) | eq;
+        word ph = mv | ~(xh | pv);
+        word mh = pv & xh;
+
+        int hout = static_cast<int>(ph >> 63) - static_cast<int>(mh >> 63);
+        ph = (ph << 1) | (hin > 0 ? 1 : 0);
+        mh = (mh << 1) | hin_neg;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+        return hout;
+    }
+
+    // Distance at the last query base, from the last block's score less the padding rows.
+    int64_t last_row_score() const
+    {
+        int64_t pad = static_cast<int64_t>(blocks_) * block_bases - length_;
+        if (pad == 0)
+            return score_.back();
+
+        word mask = ~0ULL << (block_bases - pad);
+        return score_.back() - __builtin_popcountll(pv_.back() & mask) + __builtin_popcountll(mv_.back() & mask);
+    }
+
+    template<typename F>
+    void step(base b, F& found)
+    {
+        const auto& peq = peq_[static_cast<std::size_t>(b)];
+
+        // The distances of a column can only reach one row further down than those of the
+        // column before, so the next block is needed if the last one ended within max_edits.
+        // Its previous column is taken to grow by one per row, which never underestimates.
+        if (last_ + 1 < blocks_ && score_[last_] <= max_edits_)
+        {
+            ++last_;
+            pv_[last_] = ~0ULL;
+            mv_[last_] = 0;
+            score_[last_] = score_[last_ - 1] + block_bases;
+        }
+
+        int hin = 0; // a match may start anywhere in the helix
+        for (std::size_t i = 0; i <= last_; ++i)
+        {
+            hin = advance(pv_[i], mv_[i], peq[i], hin);
+            score_[i] += hin;
+        }
+
+        // Drop the blocks that only hold distances above max_edits. A block's rows are at
+        // most 63 apart in distance from its last row.
+        while (last_ > 0 && score_[last_] >= max_edits_ + block_bases)
+            --last_;
+
+        ++offset_;
+        if (last_ + 1 == blocks_)
+        {
+            int64_t distance = last_row_score();
+            if (distance <= max_edits_)
+                found(approximate_match{offset_, distance});
+        }
+    }
+
+public:
+    template<ByteBuffer B>
+    region_search(const sequence_buffer<B>& query, int64_t max_edits)
+        : length_(query.size()), max_edits_(std::max<int64_t>(max_edits, 0)),
+          blocks_(std::max<std::size_t>((query.size() + block_bases - 1) / block_bases, 1))
+    {
+        for (auto& peq : peq_)
+            peq.assign(blocks_, 0);
+
+        int64_t i = 0;
+        for (auto b : query)
+        {
+            peq_[static_cast<std::size_t>(b)][i / block_bases] |= 1ULL << (i % block_bases);
+            ++i;
+        }
+
+        pv_.resize(blocks_);
+        mv_.resize(blocks_);
+        score_.resize(blocks_);
+        reset();
+    }
+
+    int64_t length() const
+    {
+        return length_;
+    }
+
+    int64_t max_edits() const
+    {
+        return max_edits_;
+    }
+
+    // Starts over, as if no helix bases had been fed.
+    void reset()
+    {
+        // Before any helix base the distance of a row is its row number.
+        for (std::size_t i = 0; i < blocks_; ++i)
+        {
+            pv_[i] = ~0ULL;
+            mv_[i] = 0;
+            score_[i] = static_cast<int64_t>(i + 1) * block_bases;
+        }
+        last_ = std::min<std::size_t>(static_cast<std::size_t>(max_edits_ / block_bases), blocks_ - 1);
+        offset_ = 0;
+    }
+
+    // Feeds the next bases of the helix, calling found(approximate_match) for every end of a
+    // match among them. Offsets count from the first base fed since the last reset.
+    template<ByteBuffer B, typename F>
+    void feed(const sequence_buffer<B>& bases, F&& found)
+    {
+        if (length_ == 0)
+        {
+            // The empty query matches everywhere.
+            for (std::size_t i = 0; i < bases.size(); ++i)
+                found(approximate_match{++offset_, 0});
+            return;
+        }
+
+        const std::size_t len = bases.size();
+        for (std::size_t i = 0; i < len; i += word_bases)
+        {
+            word w = bases.word_at(i);
+            std::size_t count = std::min(word_bases, len - i);
+            for (std::size_t k = 0; k < count; ++k)
+                step(static_cast<base>((w >> (62 - 2 * k)) & 0x3), found);
+        }
+    }
+
+    // Scans a whole helix, streaming it chunk by chunk, and calls found(approximate_match)
+    // for every end of a match. The stream is left at its end.
+    template<HelixStream T, typename F>
+    void scan(T& helix, F&& found)
+    {
+        reset();
+        prefetch(helix, 0, helix.size());
+        helix.seek(0);
+        for (auto buf = helix.read(); buf.size() > 0; buf = helix.read())
+            feed(buf, found);
+    }
+
+    // Every end of a match in a helix, in helix order.
+    template<HelixStream T>
+    std::vector<approximate_match> scan(T& helix)
+    {
+        std::vector<approximate_match> matches;
+        scan(helix, [&matches](const approximate_match& m) { matches.push_back(m); });
+        return matches;
+    }
+};
+
+} // dna
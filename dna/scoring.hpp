@@ -0,0 +1,161 @@
+#pragma once
+
+#include "base.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+
+namespace dna {
+
+// How an alignment engine scores an alignment, higher being better: substitution(a, b) for a
+// base of helix 1 aligned to one of helix 2, and gap_open() + n * gap_extend() for a gap of n
+// bases (so gap scores are negative, and gap_open() 0 makes gaps linear).
+//
+// The engines take a policy as a template parameter and keep an instance of it, so the compile
+// time policies below, which are empty and return constants, fold into fully specialized inner
+// loops. runtime_scoring holds its scores and has every cell load them instead, it is meant for
+// scores that are only known at run time.
+template<typename S>
+concept bool ScoringPolicy = requires(const S s, base a) {
+    { s.substitution(a, a) } -> int32_t;
+    { s.gap_open() } -> int32_t;
+    { s.gap_extend() } -> int32_t;
+};
+
+template<int32_t Match, int32_t Mismatch, int32_t Gap>
+struct linear_scoring
+{
+    static constexpr int32_t substitution(base a, base b)
+    {
+        return a == b ? Match : Mismatch;
+    }
+
+    static constexpr int32_t gap_open() { return 0; }
+    static constexpr int32_t gap_extend() { return Gap; }
+};
+
+template<int32_t Match, int32_t Mismatch, int32_t GapOpen, int32_t GapExtend>
+struct affine_scoring
+{
+    static constexpr int32_t substitution(base a, base b)
+    {
+        return a == b ? Match : Mismatch;
+    }
+
+    static constexpr int32_t gap_open() { return GapOpen; }
+    static constexpr int32_t gap_extend() { return GapExtend; }
+};
+
+// Substitutions scored by a 4x4 table, Table::scores[a][b] with the bases in A, C, G, T order.
+template<typename Table, int32_t GapOpen, int32_t GapExtend>
+struct matrix_scoring
+{
+    static constexpr int32_t substitution(base a, base b)
+    {
+        return Table::scores[static_cast<int>(a)][static_cast<int>(b)];
+    }
+
+    static constexpr int32_t gap_open() { return GapOpen; }
+    static constexpr int32_t gap_extend() { return GapExtend; }
+};
+
+// A substitution table that tells transitions (A <-> G and C <-> T, a purine for a purine or a
+// pyrimidine for a pyrimidine) from the rarer transversions.
+template<int32_t Match, int32_t Transition, int32_t Transversion>
+struct transition_table
+{
+    static constexpr int32_t scores[4][4] = {
+        // A            C             G             T
+        { Match,        Transversion, Transition,   Transversion }, // A
+        { Transversion, Match,        Transversion, Transition },   // C
+        { Transition,   Transversion, Match,        Transversion }, // G
+        { Transversion, Transition,   Transversion, Match },        // T
+    };
+};
+
+template<int32_t Match, int32_t Transition, int32_t Transversion, int32_t GapOpen, int32_t GapExtend>
+using transition_scoring = matrix_scoring<transition_table<Match, Transition, Transversion>, GapOpen, GapExtend>;
+
+// FOGSAA's scores: +1 match, -1 mismatch, -2 per gap base. The engines' default.
+using fogsaa_scoring = linear_scoring<1, -1, -2>;
+
+// Scores chosen at run time. Opt in only where they really vary, the compile time policies are
+// faster.
+class runtime_scoring
+{
+    int32_t scores_[4][4];
+    int32_t gap_open_;
+    int32_t gap_extend_;
+
+public:
+    runtime_scoring(int32_t match, int32_t mismatch, int32_t gap_open, int32_t gap_extend)
+        : gap_open_(gap_open), gap_extend_(gap_extend)
+    {
+        for (int a = 0; a < 4; ++a)
+            for (int b = 0; b < 4; ++b)
+                scores_[a][b] = a == b ? match : mismatch;
+    }
+
+    // The same scores as another policy.
+    template<ScoringPolicy S>
+    explicit runtime_scoring(const S& policy)
+        : gap_open_(policy.gap_open()), gap_extend_(policy.gap_extend())
+    {
+        for (int a = 0; a < 4; ++a)
+            for (int b = 0; b < 4; ++b)
+                scores_[a][b] = policy.substitution(static_cast<base>(a), static_cast<base>(b));
+    }
+
+    int32_t substitution(base a, base b) const
+    {
+        return scores_[static_cast<int>(a)][static_cast<int>(b)];
+    }
+
+    int32_t gap_open() const { return gap_open_; }
+    int32_t gap_extend() const { return gap_extend_; }
+};
+
+// Whether a policy's gap scores are compile time constants, so engines that can't score every
+// kind of gap can reject the others with a static_assert.
+template<typename S, typename = void>
+struct constant_gap_scores : std::false_type {};
+
+template<typename S>
+struct constant_gap_scores<S, std::void_t<std::integral_constant<int32_t, S::gap_open()>,
+        std::integral_constant<int32_t, S::gap_extend()>>> : std::true_type {};
+
+// The highest score of any pair of bases.
+template<ScoringPolicy S>
+constexpr int32_t best_substitution(const S& scoring)
+{
+    int32_t best = scoring.substitution(A, A);
+    for (int a = 0; a < 4; ++a)
+        for (int b = 0; b < 4; ++b)
+            best = std::max(best, scoring.substitution(static_cast<base>(a), static_cast<base>(b)));
+    return best;
+}
+
+// The lowest score of any pair of bases.
+template<ScoringPolicy S>
+constexpr int32_t worst_substitution(const S& scoring)
+{
+    int32_t worst = scoring.substitution(A, A);
+    for (int a = 0; a < 4; ++a)
+        for (int b = 0; b < 4; ++b)
+            worst = std::min(worst, scoring.substitution(static_cast<base>(a), static_cast<base>(b)));
+    return worst;
+}
+
+// Whether every match scores the same, and every mismatch.
+template<ScoringPolicy S>
+constexpr bool uniform_substitutions(const S& scoring)
+{
+    for (int a = 0; a < 4; ++a)
+        for (int b = 0; b < 4; ++b)
+            if (scoring.substitution(static_cast<base>(a), static_cast<base>(b))
+                    != scoring.substitution(A, a == b ? A : C))
+                return false;
+    return true;
+}
+
+} // dna
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "anchor_chain.hpp"
+#include "packed_stream.hpp"
+#include "partial_result.hpp"
+#include "person.hpp"
+#include "sequence_aligner.hpp"
+#include "thread_pool.hpp"
+#include <future>
+
+namespace dna {
+
+// Combines the results of aligning each segment of a helix pair into the result for the
+// whole pair. Segment results hold offsets relative to their segment, the segments cover
+// both helixes.
+inline alignment_result stitch_segments(const std::vector<segment>& segments,
+        std::vector<alignment_result>&& results, int64_t len1, int64_t len2)
+{
+    std::vector<partial_result> parts;
+    parts.reserve(segments.size());
+    for (std::size_t i = 0; i < segments.size(); ++i)
+        parts.emplace_back(segments[i], std::move(results[i]));
+
+    partial_result whole = merge_all(std::move(parts));
+    whole.helix1.length = len1; // in case there were no segments
+    whole.helix2.length = len2;
+    return whole.to_result();
+}
+
+// Aligns one segment of two loaded helixes.
+inline alignment_result align_segment(const sequence_aligner<packed_stream>& aligner,
+        const helix_bases& s1, const helix_bases& s2, const segment& seg)
+{
+    packed_stream h1(s1, seg.helix1.offset, seg.helix1.length);
+    packed_stream h2(s2, seg.helix2.offset, seg.helix2.length);
+    return aligner.align(h1, h2);
+}
+
+// Splits a helix pair into independent segments at exact matches both helixes share and
+// aligns every segment with segment_aligner. This turns one long chromosome into many small
+// units of work: when given a pool the segments are aligned on it concurrently. align() may
+// itself run on that pool (as under pairwise_aligner), it waits for its segments through
+// thread_pool::wait, which keeps the worker running queued tasks meanwhile.
+template<HelixStream T>
+class segmented_aligner : public sequence_aligner<T>
+{
+    sequence_aligner<packed_stream>& segment_aligner_;
+    thread_pool* pool_;
+    int64_t min_segment_;
+    anchor_finder finder_;
+
+public:
+    explicit segmented_aligner(sequence_aligner<packed_stream>& segment_aligner,
+            thread_pool* pool = nullptr, int64_t min_segment = 1 << 16, int64_t anchor_stride = 1024)
+        : segment_aligner_(segment_aligner), pool_(pool), min_segment_(min_segment), finder_(anchor_stride)
+    {}
+
+    alignment_result align(T& a, T& b) const override
+    {
+        if (a.size() == 0 && b.size() == 0)
+        {
+            alignment_result res;
+            res.similarity_score = 1;
+            return res;
+        }
+
+        if (a.size() == 0 || b.size() == 0)
+        {
+            alignment_result res;
+            res.error = NoDataErr;
+            return res;
+        }
+
+        helix_bases s1 = read_helix(a);
+        helix_bases s2 = read_helix(b);
+        std::vector<segment> segments = finder_.plan(s1.view(), s2.view(), min_segment_);
+
+        std::vector<alignment_result> results;
+        results.reserve(segments.size());
+        if (pool_ != nullptr)
+        {
+            std::vector<std::future<alignment_result>> futures;
+            futures.reserve(segments.size());
+            for (auto& seg : segments)
+                futures.push_back(pool_->enqueue([this, s1, s2, seg]
+                        {
+                            return align_segment(segment_aligner_, s1, s2, seg);
+                        }));
+            for (auto& f : futures)
+                results.push_back(pool_->wait(f));
+        } else
+        {
+            for (auto& seg : segments)
+                results.push_back(align_segment(segment_aligner_, s1, s2, seg));
+        }
+
+        return stitch_segments(segments, std::move(results), s1.size(), s2.size());
+    }
+};
+
+} // dna
@@ -3,10 +3,14 @@
 #include "sequence_buffer.hpp"
 #include "person.hpp"
 #include <cstdint>
+#include <string>
 #include <vector>
 
 namespace dna {
 
+const std::string NoDataErr = "A stream did not have data";
+const std::string ChromoMismatchMFErr = "Cannot match an X with a Y chromosome";
+
 // Defines the location of a subsequence in a helix.
 struct location
 {
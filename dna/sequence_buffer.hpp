@@ -1,8 +1,15 @@
 #pragma once
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <vector>
 #include "base.hpp"
 
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 namespace dna
 {
 
@@ -12,6 +19,59 @@ concept bool ByteBuffer = requires(T a) {
 	{ a[0] } -> std::byte;
 };
 
+// A byte buffer whose bytes are laid out contiguously in memory. These buffers can be
+// compared with wide loads instead of one byte at a time.
+template<typename T>
+concept bool ContiguousByteBuffer = ByteBuffer<T> && requires(const T a) {
+	{ a.data() } -> const std::byte*;
+};
+
+// A non owning view over contiguous packed bytes.
+class byte_span
+{
+	const std::byte* data_;
+	std::size_t size_;
+public:
+	constexpr byte_span() noexcept :
+			data_(nullptr),
+			size_(0)
+	{ }
+
+	constexpr byte_span(const std::byte* data, std::size_t size) noexcept :
+			data_(data),
+			size_(size)
+	{ }
+
+	constexpr std::byte operator[](std::size_t index) const noexcept
+	{
+		return data_[index];
+	}
+
+	constexpr const std::byte* data() const noexcept
+	{
+		return data_;
+	}
+
+	constexpr std::size_t size() const noexcept
+	{
+		return size_;
+	}
+};
+
+// Number of bases held by one packed 64 bit word.
+static constexpr std::size_t word_bases = sizeof(std::uint64_t) * packed_size::value;
+
+// Selects the low bit of every 2 bit base in a packed word.
+static constexpr std::uint64_t base_lsb_mask = 0x5555555555555555ULL;
+
+// Reduces the xor of two packed words to one set bit (the low bit of the base) per
+// mismatched base.
+constexpr std::uint64_t mismatch_bits(std::uint64_t a, std::uint64_t b)
+{
+	auto diff = a ^ b;
+	return (diff | (diff >> 1)) & base_lsb_mask;
+}
+
 template<ByteBuffer T>
 class sequence_buffer;
 
@@ -134,9 +194,97 @@ public:
 	constexpr base at(std::size_t index) const
 	{
 		auto boffset = index / packed_size::value;
-		auto tidx = index - (boffset * packed_size::value);
+		auto shift = (packed_size::value - 1 - (index % packed_size::value)) * 2;
+
+		return static_cast<base>((buffer_[boffset] >> shift) & std::byte{0x3});
+	}
+
+	// Returns the (up to) 32 bases starting at index packed into a word, first base in the
+	// most significant bits (the same order as the packed bytes). Bases past the end of the
+	// buffer read as zero.
+	constexpr std::uint64_t word_at(std::size_t index) const
+	{
+		if (index >= size_)
+			return 0;
+
+		auto boffset = index / packed_size::value;
+		auto phase = index % packed_size::value;
+		auto bytes = std::min(static_cast<std::size_t>(buffer_.size()) - boffset, sizeof(std::uint64_t) + 1);
+
+		std::uint64_t word = 0;
+		std::size_t i = 0;
+		for (; i < std::min(bytes, sizeof(std::uint64_t)); ++i)
+			word = (word << 8) | static_cast<std::uint64_t>(buffer_[boffset + i]);
+		word <<= (sizeof(std::uint64_t) - i) * 8;
+
+		if (phase != 0)
+		{
+			word <<= phase * 2;
+			if (bytes > sizeof(std::uint64_t))
+				word |= static_cast<std::uint64_t>(buffer_[boffset + sizeof(std::uint64_t)]) >> (8 - phase * 2);
+		}
+
+		auto remaining = size_ - index;
+		if (remaining < word_bases)
+			word &= ~0ULL << ((word_bases - remaining) * 2);
+
+		return word;
+	}
+
+	// Finds the first base at or after from where this buffer and other differ. Only the bases
+	// both buffers hold are compared; if they agree on all of them the shorter size is returned.
+	template<ByteBuffer U>
+	std::size_t mismatch(const sequence_buffer<U>& other, std::size_t from = 0) const
+	{
+		auto len = std::min(size_, other.size());
+		auto index = skip_equal_bytes(*this, other, from, len);
+
+		while (index < len)
+		{
+			auto bits = mismatch_bits(word_at(index), other.word_at(index));
+			if (bits != 0)
+				return std::min(index + __builtin_clzll(bits) / 2, len);
+
+			// Back to a byte boundary (rechecking at most 3 bases) so a scan restarted
+			// mid-byte gets the register skip again.
+			index = skip_equal_bytes(*this, other,
+					(index + word_bases) / packed_size::value * packed_size::value, len);
+		}
+
+		return len;
+	}
 
-		return unpack(buffer_[boffset])[tidx];
+	// Lists every base position (over the shared length) where this buffer and other differ.
+	template<ByteBuffer U>
+	std::vector<std::size_t> mismatches(const sequence_buffer<U>& other) const
+	{
+		std::vector<std::size_t> result;
+		auto len = std::min(size_, other.size());
+
+		for (auto index = mismatch(other); index < len; index = mismatch(other, index + 1))
+			result.push_back(index);
+
+		return result;
+	}
+
+	// Counts the bases (over the shared length) where this buffer and other differ.
+	template<ByteBuffer U>
+	std::size_t count_mismatches(const sequence_buffer<U>& other) const
+	{
+		std::size_t count = 0;
+		auto len = std::min(size_, other.size());
+
+		auto index = skip_equal_bytes(*this, other, 0, len);
+		while (index < len)
+		{
+			auto bits = mismatch_bits(word_at(index), other.word_at(index));
+			if (len - index < word_bases)
+				bits &= ~0ULL << ((word_bases - (len - index)) * 2);
+			count += __builtin_popcountll(bits);
+			index = skip_equal_bytes(*this, other, index + word_bases, len);
+		}
+
+		return count;
 	}
 
 	constexpr base operator[](std::size_t index) const
@@ -166,10 +314,80 @@ public:
 
 	constexpr T& buffer() noexcept
 	{
-		buffer_;
+		return buffer_;
 	}
 };
 
+// Advances from past whole bytes that are identical in both buffers, comparing a register
+// of bytes at a time. The result is always <= the first mismatching base. Buffers that are
+// not contiguous (or are compared from a base that is not byte aligned) are left to the
+// word level scan.
+template<ByteBuffer T, ByteBuffer U>
+std::size_t skip_equal_bytes(const sequence_buffer<T>&, const sequence_buffer<U>&, std::size_t from, std::size_t)
+{
+	return from;
+}
+
+template<ContiguousByteBuffer T, ContiguousByteBuffer U>
+std::size_t skip_equal_bytes(const sequence_buffer<T>& a, const sequence_buffer<U>& b, std::size_t from, std::size_t len)
+{
+	if (from % packed_size::value != 0)
+		return from;
+
+	const std::byte* pa = a.buffer().data();
+	const std::byte* pb = b.buffer().data();
+	std::size_t i = from / packed_size::value;
+	const std::size_t end = len / packed_size::value; // only whole bytes, the tail is masked per word
+
+#if defined(__AVX2__)
+	for (; i + sizeof(__m256i) <= end; i += sizeof(__m256i))
+	{
+		auto va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pa + i));
+		auto vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pb + i));
+		if (static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb))) != 0xffffffffU)
+			break;
+	}
+#endif
+#if defined(__SSE2__)
+	for (; i + sizeof(__m128i) <= end; i += sizeof(__m128i))
+	{
+		auto va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pa + i));
+		auto vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pb + i));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) != 0xffff)
+			break;
+	}
+#endif
+	for (; i + sizeof(std::uint64_t) <= end; i += sizeof(std::uint64_t))
+	{
+		std::uint64_t wa, wb;
+		__builtin_memcpy(&wa, pa + i, sizeof(wa));
+		__builtin_memcpy(&wb, pb + i, sizeof(wb));
+		if (wa != wb)
+			break;
+	}
+
+	return i * packed_size::value;
+}
+
+// Number of equal bases from i in v1 and j in v2, at most limit. The helixes may be at
+// different offsets, so they are compared a word (32 bases) at a time.
+inline int64_t match_run(const sequence_buffer<byte_span>& v1, int64_t i,
+		const sequence_buffer<byte_span>& v2, int64_t j, int64_t limit)
+{
+	int64_t n = 0;
+	while (n < limit)
+	{
+		int64_t count = std::min<int64_t>(word_bases, limit - n);
+		auto bits = mismatch_bits(v1.word_at(i + n), v2.word_at(j + n));
+		bits &= ~0ULL << ((word_bases - count) * 2);
+		if (bits != 0)
+			return n + __builtin_clzll(bits) / 2;
+		n += count;
+	}
+
+	return limit;
+}
+
 
 template<ByteBuffer T>
 constexpr typename sequence_buffer_iterator<T>::value_type sequence_buffer_iterator<T>::operator*() const
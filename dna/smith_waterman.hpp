@@ -0,0 +1,406 @@
+#pragma once
+
+#include "packed_sequence.hpp"
+#include "packed_stream.hpp"
+#include "person.hpp"
+#include "scoring.hpp"
+#include "sequence_aligner.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace dna {
+
+// The best scoring local alignment of a query against a target: the part of each that was
+// aligned. Both are empty if nothing scores above 0.
+struct local_alignment
+{
+    int64_t score = 0;
+    location query;
+    location target;
+};
+
+namespace detail {
+
+// Saturating score lanes for the striped kernel. Unsigned bytes hold scores offset by a bias
+// (so mismatches can be added), signed shorts hold them as is and are floored at 0 instead.
+#if defined(__AVX2__)
+struct sw_u8
+{
+    using vec = __m256i;
+    using value = std::uint8_t;
+    static constexpr std::size_t lanes = sizeof(vec) / sizeof(value);
+    static constexpr int32_t max_value = 255;
+
+    static vec set1(int32_t v) { return _mm256_set1_epi8(static_cast<char>(v)); }
+    static vec zero() { return _mm256_setzero_si256(); }
+    static vec adds(vec a, vec b) { return _mm256_adds_epu8(a, b); }
+    static vec subs(vec a, vec b) { return _mm256_subs_epu8(a, b); }
+    static vec max(vec a, vec b) { return _mm256_max_epu8(a, b); }
+    static vec add_score(vec h, vec p, vec bias) { return _mm256_subs_epu8(_mm256_adds_epu8(h, p), bias); }
+
+    static bool any_greater(vec a, vec b)
+    {
+        return _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_subs_epu8(a, b), zero())) != -1;
+    }
+
+    // Moves every lane up by one (across the two 128 bit halves), lane 0 becomes 0.
+    static vec shift(vec a) { return _mm256_alignr_epi8(a, _mm256_permute2x128_si256(a, a, 0x08), 16 - sizeof(value)); }
+};
+
+struct sw_i16
+{
+    using vec = __m256i;
+    using value = std::int16_t;
+    static constexpr std::size_t lanes = sizeof(vec) / sizeof(value);
+    static constexpr int32_t max_value = 32767;
+
+    static vec set1(int32_t v) { return _mm256_set1_epi16(static_cast<short>(v)); }
+    static vec zero() { return _mm256_setzero_si256(); }
+    static vec adds(vec a, vec b) { return _mm256_adds_epi16(a, b); }
+    static vec subs(vec a, vec b) { return _mm256_subs_epi16(a, b); }
+    static vec max(vec a, vec b) { return _mm256_max_epi16(a, b); }
+    static vec add_score(vec h, vec p, vec) { return _mm256_max_epi16(_mm256_adds_epi16(h, p), zero()); }
+    static bool any_greater(vec a, vec b) { return _mm256_movemask_epi8(_mm256_cmpgt_epi16(a, b)) != 0; }
+    static vec shift(vec a) { return _mm256_alignr_epi8(a, _mm256_permute2x128_si256(a, a, 0x08), 16 - sizeof(value)); }
+};
+#elif defined(__SSE2__)
+struct sw_u8
+{
+    using vec = __m128i;
+    using value = std::uint8_t;
+    static constexpr std::size_t lanes = sizeof(vec) / sizeof(value);
+    static constexpr int32_t max_value = 255;
+
+    static vec set1(int32_t v) { return _mm_set1_epi8(static_cast<char>(v)); }
+    static vec zero() { return _mm_setzero_si128(); }
+    static vec adds(vec a, vec b) { return _mm_adds_epu8(a, b); }
+    static vec subs(vec a, vec b) { return _mm_subs_epu8(a, b); }
+    static vec max(vec a, vec b) { return _mm_max_epu8(a, b); }
+    static vec add_score(vec h, vec p, vec bias) { return _mm_subs_epu8(_mm_adds_epu8(h, p), bias); }
+
+    static bool any_greater(vec a, vec b)
+    {
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_subs_epu8(a, b), zero())) != 0xffff;
+    }
+
+    static vec shift(vec a) { return _mm_slli_si128(a, sizeof(value)); }
+};
+
+struct sw_i16
+{
+    using vec = __m128i;
+    using value = std::int16_t;
+    static constexpr std::size_t lanes = sizeof(vec) / sizeof(value);
+    static constexpr int32_t max_value = 32767;
+
+    static vec set1(int32_t v) { return _mm_set1_epi16(static_cast<short>(v)); }
+    static vec zero() { return _mm_setzero_si128(); }
+    static vec adds(vec a, vec b) { return _mm_adds_epi16(a, b); }
+    static vec subs(vec a, vec b) { return _mm_subs_epi16(a, b); }
+    static vec max(vec a, vec b) { return _mm_max_epi16(a, b); }
+    static vec add_score(vec h, vec p, vec) { return _mm_max_epi16(_mm_adds_epi16(h, p), zero()); }
+    static bool any_greater(vec a, vec b) { return _mm_movemask_epi8(_mm_cmpgt_epi16(a, b)) != 0; }
+    static vec shift(vec a) { return _mm_slli_si128(a, sizeof(value)); }
+};
+#endif
+
+// One register of lanes, for keeping registers in containers: the alignment attributes of the
+// vector types are dropped when they are template arguments themselves.
+template<typename V>
+struct alignas(typename V::vec) lane_block
+{
+    typename V::vec v;
+};
+
+// Where the best local alignment ends. overflow is set if its score didn't fit the lanes.
+struct local_end
+{
+    int64_t score = 0;
+    int64_t query = -1; // last aligned base
+    int64_t target = -1;
+    bool overflow = false;
+};
+
+} // detail
+
+// Local alignment (Smith-Waterman with affine gaps) of one query against any number of
+// targets, such as a region of one person against candidate windows of another person's
+// helix, scored by a ScoringPolicy (FOGSAA's scores by default).
+//
+// The inner loop is Farrar's striped kernel: the query is laid out in as many segments as a
+// register has lanes, lane k of segment j holding query base j + k * segments, so the cells
+// of a register never depend on each other. Per target base the column is computed a
+// register at a time, followed by a (usually short) pass that fixes the vertical gaps that
+// cross from one lane into the next. Scores are first computed in byte lanes; if the best
+// score saturates them the target is aligned again in 16 bit lanes, and then in plain 64 bit
+// arithmetic.
+//
+// The query profiles (a register of scores per base, per segment) are built from the packed
+// query once, in the constructor.
+template<ScoringPolicy Scoring = fogsaa_scoring>
+class striped_smith_waterman
+{
+    Scoring scoring_;
+    std::vector<std::uint8_t> query_;
+
+    // The kernel subtracts penalties: gap_open() for the first base of a gap (on top of its
+    // gap_extend()), gap_extend() for every one after it.
+    int32_t open_penalty() const
+    {
+        return -(scoring_.gap_open() + scoring_.gap_extend());
+    }
+
+    int32_t extend_penalty() const
+    {
+        return -scoring_.gap_extend();
+    }
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    int32_t bias_; // added to every byte lane score so mismatches are not negative
+    std::array<std::vector<detail::lane_block<detail::sw_u8>>, 4> profile_u8_;
+    std::array<std::vector<detail::lane_block<detail::sw_i16>>, 4> profile_i16_;
+
+    template<typename V>
+    static std::size_t segments(std::size_t length)
+    {
+        return std::max<std::size_t>((length + V::lanes - 1) / V::lanes, 1);
+    }
+
+    template<typename V>
+    void build_profile(std::array<std::vector<detail::lane_block<V>>, 4>& profile, int32_t bias, int32_t padding) const
+    {
+        const std::size_t segs = segments<V>(query_.size());
+        alignas(typename V::vec) typename V::value lanes[V::lanes];
+        for (std::size_t b = 0; b < profile.size(); ++b)
+        {
+            profile[b].resize(segs);
+            for (std::size_t j = 0; j < segs; ++j)
+            {
+                for (std::size_t k = 0; k < V::lanes; ++k)
+                {
+                    std::size_t q = j + k * segs;
+                    lanes[k] = static_cast<typename V::value>(q >= query_.size() ? padding
+                            : scoring_.substitution(static_cast<base>(query_[q]), static_cast<base>(b)) + bias);
+                }
+                std::memcpy(&profile[b][j].v, lanes, sizeof(lanes));
+            }
+        }
+    }
+
+    template<typename V>
+    detail::local_end striped(const std::array<std::vector<detail::lane_block<V>>, 4>& profile, int32_t bias,
+            const std::vector<std::uint8_t>& target) const
+    {
+        using vec = typename V::vec;
+        using block = detail::lane_block<V>;
+        const std::size_t segs = profile[0].size();
+        const vec vbias = V::set1(bias);
+        const vec vgap_open = V::set1(open_penalty());
+        const vec vgap_extend = V::set1(extend_penalty());
+
+        std::vector<block> load(segs, block{V::zero()}), store(segs, block{V::zero()}), e(segs, block{V::zero()}),
+            best_column(segs);
+        detail::local_end end;
+        int32_t best = 0;
+
+        for (std::size_t t = 0; t < target.size(); ++t)
+        {
+            const block* p = profile[target[t]].data();
+            vec f = V::zero();
+            vec column_max = V::zero();
+            vec h = V::shift(store[segs - 1].v); // the diagonal into lane k comes from lane k - 1
+            std::swap(load, store);
+
+            for (std::size_t j = 0; j < segs; ++j)
+            {
+                h = V::add_score(h, p[j].v, vbias);
+                h = V::max(h, e[j].v);
+                h = V::max(h, f);
+                column_max = V::max(column_max, h);
+                store[j].v = h;
+
+                h = V::subs(h, vgap_open);
+                e[j].v = V::max(V::subs(e[j].v, vgap_extend), h);
+                f = V::max(V::subs(f, vgap_extend), h);
+                h = load[j].v;
+            }
+
+            // Vertical gaps leaving the last segment continue in the first one, a lane down.
+            f = V::shift(f);
+            for (std::size_t j = 0, passes = 0;
+                    passes < V::lanes && V::any_greater(f, V::subs(store[j].v, vgap_open)); )
+            {
+                h = V::max(store[j].v, f);
+                store[j].v = h;
+                column_max = V::max(column_max, h);
+                e[j].v = V::max(e[j].v, V::subs(h, vgap_open));
+                f = V::subs(f, vgap_extend);
+                if (++j == segs)
+                {
+                    j = 0;
+                    ++passes;
+                    f = V::shift(f);
+                }
+            }
+
+            alignas(vec) typename V::value lanes[V::lanes];
+            std::memcpy(lanes, &column_max, sizeof(lanes));
+            int32_t m = *std::max_element(lanes, lanes + V::lanes);
+            if (m > best)
+            {
+                best = m;
+                end.target = static_cast<int64_t>(t);
+                std::copy(store.begin(), store.end(), best_column.begin());
+            }
+        }
+
+        if (best + bias >= V::max_value - best_substitution(scoring_))
+        {
+            end.overflow = true;
+            return end;
+        }
+
+        // The first query base the best column reaches the best score on.
+        end.score = best;
+        if (best > 0)
+        {
+            end.query = static_cast<int64_t>(query_.size());
+            alignas(vec) typename V::value lanes[V::lanes];
+            for (std::size_t j = 0; j < segs; ++j)
+            {
+                std::memcpy(lanes, &best_column[j].v, sizeof(lanes));
+                for (std::size_t k = 0; k < V::lanes; ++k)
+                    if (lanes[k] == best)
+                        end.query = std::min<int64_t>(end.query, j + k * segs);
+            }
+        }
+        return end;
+    }
+#endif
+
+    // The same recurrences one cell at a time, for scores no lane holds.
+    detail::local_end scalar(const std::vector<std::uint8_t>& target) const
+    {
+        const int64_t n = query_.size();
+        std::vector<int64_t> h(n + 1, 0), e(n + 1, 0);
+        detail::local_end end;
+
+        for (std::size_t t = 0; t < target.size(); ++t)
+        {
+            int64_t diagonal = 0, f = 0, column_max = 0, column_end = -1;
+            for (int64_t q = 1; q <= n; ++q)
+            {
+                int64_t up = h[q];
+                e[q] = std::max<int64_t>(e[q] - extend_penalty(), h[q] - open_penalty());
+                int64_t cell = diagonal + scoring_.substitution(static_cast<base>(query_[q - 1]),
+                        static_cast<base>(target[t]));
+                cell = std::max({ cell, e[q], f, int64_t(0) });
+                f = std::max<int64_t>(f - extend_penalty(), cell - open_penalty());
+                diagonal = up;
+                h[q] = cell;
+                if (cell > column_max)
+                {
+                    column_max = cell;
+                    column_end = q - 1;
+                }
+            }
+
+            if (column_max > end.score)
+            {
+                end.score = column_max;
+                end.query = column_end;
+                end.target = static_cast<int64_t>(t);
+            }
+        }
+        return end;
+    }
+
+    detail::local_end best_end(const std::vector<std::uint8_t>& target) const
+    {
+#if defined(__AVX2__) || defined(__SSE2__)
+        auto end = striped<detail::sw_u8>(profile_u8_, bias_, target);
+        if (!end.overflow)
+            return end;
+        end = striped<detail::sw_i16>(profile_i16_, 0, target);
+        if (!end.overflow)
+            return end;
+#endif
+        return scalar(target);
+    }
+
+    striped_smith_waterman(std::vector<std::uint8_t> query, const Scoring& scoring)
+        : scoring_(scoring), query_(std::move(query))
+    {
+#if defined(__AVX2__) || defined(__SSE2__)
+        bias_ = std::max(-worst_substitution(scoring_), 0);
+        build_profile<detail::sw_u8>(profile_u8_, bias_, 0);
+        build_profile<detail::sw_i16>(profile_i16_, 0, -0x4000);
+#endif
+    }
+
+    template<ByteBuffer B>
+    static std::vector<std::uint8_t> unpack(const sequence_buffer<B>& seq)
+    {
+        std::vector<std::uint8_t> codes(seq.size());
+        for (std::size_t i = 0; i < codes.size(); i += word_bases)
+        {
+            std::uint64_t word = seq.word_at(i);
+            std::size_t count = std::min(word_bases, codes.size() - i);
+            for (std::size_t k = 0; k < count; ++k)
+                codes[i + k] = static_cast<std::uint8_t>((word >> (62 - 2 * k)) & 0x3);
+        }
+        return codes;
+    }
+
+public:
+    template<ByteBuffer B>
+    explicit striped_smith_waterman(const sequence_buffer<B>& query, const Scoring& scoring = Scoring())
+        : striped_smith_waterman(unpack(query), scoring)
+    {}
+
+    std::size_t length() const
+    {
+        return query_.size();
+    }
+
+    // The best local alignment of the query against target. Where several end equally well
+    // the one ending first in the target (then in the query) is taken. Its start is found by
+    // aligning the reversed query and target up to that end the same way.
+    template<ByteBuffer B>
+    local_alignment align(const sequence_buffer<B>& target) const
+    {
+        local_alignment res;
+        auto codes = unpack(target);
+        auto end = best_end(codes);
+        if (end.score <= 0)
+            return res;
+
+        // An alignment of the query bases up to the end can't take more target bases than
+        // those plus as many gap bases as its score leaves room for.
+        int64_t query_bases = end.query + 1;
+        int64_t gap_bases = (query_bases * best_substitution(scoring_) - end.score)
+            / std::max(std::min(open_penalty(), extend_penalty()), 1) + 1;
+        int64_t first = std::max<int64_t>(end.target + 1 - query_bases - gap_bases, 0);
+
+        std::vector<std::uint8_t> rquery(query_.rend() - query_bases, query_.rend());
+        std::vector<std::uint8_t> rtarget(codes.rbegin() + (codes.size() - end.target - 1), codes.rend() - first);
+        auto start = striped_smith_waterman(std::move(rquery), scoring_).best_end(rtarget);
+
+        res.score = end.score;
+        res.query = location{end.query - start.query, start.query + 1};
+        res.target = location{end.target - start.target, start.target + 1};
+        return res;
+    }
+
+    // Reads a whole helix (a candidate window) and aligns the query against it.
+    template<HelixStream T>
+    local_alignment align(T& helix) const
+    {
+        return align(read_helix(helix).view());
+    }
+};
+
+} // dna
@@ -0,0 +1,294 @@
+#pragma once
+
+#include "packed_sequence.hpp"
+#include "person.hpp"
+#include "sequence_aligner.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+namespace dna {
+
+// A 6 base telomere repeat, precomputed for every phase (the base of the motif a run starts
+// on): one packed word of 32 bases and a block of packed bytes. A byte holds 4 bases and the
+// motif is 6 long, so the bytes of a run only repeat every 3 bytes and a byte aligned block
+// can start on any of the 6 phases.
+class telomere_motif
+{
+public:
+    static constexpr std::size_t length = 6;
+    static constexpr std::size_t block_bytes = 32; // widest register compared at once
+
+private:
+    std::array<std::uint64_t, length> words_;
+    std::array<std::array<std::byte, block_bytes>, length> blocks_;
+
+public:
+    explicit telomere_motif(const std::array<base, length>& motif)
+    {
+        for (std::size_t phase = 0; phase < length; ++phase)
+        {
+            std::uint64_t word = 0;
+            for (std::size_t k = 0; k < word_bases; ++k)
+                word = (word << 2) | static_cast<std::uint64_t>(motif[(phase + k) % length]);
+            words_[phase] = word;
+
+            for (std::size_t b = 0; b < block_bytes; ++b)
+            {
+                std::size_t first = phase + b * packed_size::value;
+                blocks_[phase][b] = pack(motif[first % length], motif[(first + 1) % length],
+                        motif[(first + 2) % length], motif[(first + 3) % length]);
+            }
+        }
+    }
+
+    // The repeat on the strand that ends a chromosome.
+    static const telomere_motif& ttaggg()
+    {
+        static const telomere_motif motif({T, T, A, G, G, G});
+        return motif;
+    }
+
+    // The reverse complement, the repeat that starts a chromosome on the forward strand.
+    static const telomere_motif& ccctaa()
+    {
+        static const telomere_motif motif({C, C, C, T, A, A});
+        return motif;
+    }
+
+    std::uint64_t word(std::size_t phase) const
+    {
+        return words_[phase];
+    }
+
+    // True if the block_bytes bytes at p continue the motif from phase.
+    bool block_matches(const std::byte* p, std::size_t phase) const
+    {
+        const std::byte* expected = blocks_[phase].data();
+#if defined(__AVX2__)
+        auto va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        auto vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(expected));
+        return static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb))) == 0xffffffffU;
+#elif defined(__SSE2__)
+        for (std::size_t i = 0; i < block_bytes; i += sizeof(__m128i))
+        {
+            auto va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+            auto vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(expected + i));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) != 0xffff)
+                return false;
+        }
+        return true;
+#else
+        return __builtin_memcmp(p, expected, block_bytes) == 0;
+#endif
+    }
+};
+
+// Fewer bases than two full repeats are not considered a telomere, shorter runs turn up by
+// chance in random sequence.
+static constexpr int64_t min_telomere_bases = 2 * telomere_motif::length;
+
+namespace detail {
+
+inline std::size_t motif_phase(int64_t phase)
+{
+    int64_t len = telomere_motif::length;
+    return static_cast<std::size_t>(((phase % len) + len) % len);
+}
+
+// Number of bases from `from` on that continue motif, with the base at from on phase.
+inline int64_t motif_run_forward(const sequence_buffer<byte_span>& seq, const telomere_motif& motif,
+        int64_t from, int64_t phase)
+{
+    const int64_t len = seq.size();
+    const int64_t block_bases = telomere_motif::block_bytes * packed_size::value;
+    int64_t i = from;
+
+    while (i < len)
+    {
+        // whole blocks whenever byte aligned, words to find where the run ends
+        if (i % packed_size::value == 0)
+        {
+            while (i + block_bases <= len && motif.block_matches(
+                        seq.buffer().data() + i / packed_size::value, motif_phase(phase + i - from)))
+                i += block_bases;
+        }
+
+        int64_t count = std::min<int64_t>(word_bases - i % packed_size::value, len - i);
+        auto bits = mismatch_bits(seq.word_at(i), motif.word(motif_phase(phase + i - from)));
+        bits &= ~0ULL << ((word_bases - count) * 2);
+        if (bits != 0)
+            return i + __builtin_clzll(bits) / 2 - from;
+        i += count;
+    }
+
+    return len - from;
+}
+
+// Number of bases before `end` that continue motif, with the base at end - 1 on phase.
+inline int64_t motif_run_backward(const sequence_buffer<byte_span>& seq, const telomere_motif& motif,
+        int64_t end, int64_t phase)
+{
+    const int64_t last = end - 1;
+    const int64_t block_bases = telomere_motif::block_bytes * packed_size::value;
+    int64_t e = end;
+
+    while (e > 0)
+    {
+        if (e % packed_size::value == 0)
+        {
+            while (e - block_bases >= 0 && motif.block_matches(
+                        seq.buffer().data() + (e - block_bases) / packed_size::value,
+                        motif_phase(phase + (e - block_bases) - last)))
+                e -= block_bases;
+            if (e == 0)
+                break;
+        }
+
+        // the first step realigns e to a byte
+        int64_t step = e % packed_size::value != 0 ? e % packed_size::value : word_bases;
+        int64_t start = std::max<int64_t>(e - step, 0);
+        int64_t count = e - start;
+        auto bits = mismatch_bits(seq.word_at(start), motif.word(motif_phase(phase + start - last)));
+        bits &= ~0ULL << ((word_bases - count) * 2);
+        if (bits != 0)
+        {
+            int64_t mismatch = (62 - __builtin_ctzll(bits)) / 2; // last mismatched base of the word
+            return end - (start + mismatch + 1);
+        }
+        e = start;
+    }
+
+    return end;
+}
+
+} // detail
+
+// Number of bases at the start of seq that are telomere repeats (of either strand), starting
+// on any phase so a partial repeat at the very start is included. 0 if there is no telomere.
+inline int64_t telomere_prefix(const sequence_buffer<byte_span>& seq)
+{
+    int64_t best = 0;
+    for (auto motif : { &telomere_motif::ttaggg(), &telomere_motif::ccctaa() })
+        for (int64_t phase = 0; phase < static_cast<int64_t>(telomere_motif::length); ++phase)
+            best = std::max(best, detail::motif_run_forward(seq, *motif, 0, phase));
+
+    return best < min_telomere_bases ? 0 : best;
+}
+
+// Number of bases at the end of seq that are telomere repeats (of either strand), including a
+// partial repeat at the very end. 0 if there is no telomere.
+inline int64_t telomere_suffix(const sequence_buffer<byte_span>& seq)
+{
+    int64_t best = 0;
+    for (auto motif : { &telomere_motif::ttaggg(), &telomere_motif::ccctaa() })
+        for (int64_t phase = 0; phase < static_cast<int64_t>(telomere_motif::length); ++phase)
+            best = std::max(best, detail::motif_run_backward(seq, *motif, seq.size(), phase));
+
+    return best < min_telomere_bases ? 0 : best;
+}
+
+// The part of a loaded helix between its telomeres.
+inline location trim_telomeres(const packed_sequence& seq)
+{
+    auto view = seq.view();
+    int64_t front = telomere_prefix(view);
+    if (front == static_cast<int64_t>(seq.size()))
+        return location{front, 0};
+
+    return location{front, static_cast<int64_t>(seq.size()) - front - telomere_suffix(view)};
+}
+
+namespace detail {
+
+// Reads the start of a helix into front until it holds the whole front telomere, growing the
+// window as needed, and returns the telomere's length. done is set if the whole helix was read.
+template<HelixStream T>
+int64_t scan_telomere_front(T& helix, std::size_t& window, packed_sequence& front, bool& done)
+{
+    // Telomeres run for ~10k bases, so the first window normally holds all of it.
+    prefetch(helix, 0, window);
+    helix.seek(0);
+    done = false;
+    while (true)
+    {
+        while (!done && front.size() < window)
+        {
+            auto buf = helix.read();
+            if (buf.size() == 0)
+                done = true;
+            else
+                front.append(buf);
+        }
+
+        int64_t prefix = telomere_prefix(front.view());
+        if (prefix < static_cast<int64_t>(front.size()) || done)
+            return prefix;
+        window *= 2;
+    }
+}
+
+} // detail
+
+// Length of the telomere at the start of a helix, reading only as much of the stream as the
+// telomere covers (in windows of at least window bases). The stream is left at offset 0.
+template<HelixStream T>
+int64_t telomere_front(T& helix, std::size_t window = 1 << 14)
+{
+    window = std::max(window, word_bases);
+    packed_sequence front(window);
+    bool done = false;
+    int64_t prefix = detail::scan_telomere_front(helix, window, front, done);
+
+    helix.seek(0);
+    return prefix;
+}
+
+// Finds the part of a helix between its telomeres, reading only the ends of the stream. Each
+// end is read in windows of (at least) window bases, a window is only grown when the telomere
+// runs through all of it. The stream is left at offset 0.
+template<HelixStream T>
+location trim_telomeres(T& helix, std::size_t window = 1 << 14)
+{
+    const int64_t size = helix.size();
+    window = std::max(window, word_bases);
+
+    packed_sequence front(window);
+    bool done = false;
+    int64_t prefix = detail::scan_telomere_front(helix, window, front, done);
+
+    int64_t suffix = 0;
+    if (done)
+    {
+        // the whole helix was read
+        suffix = telomere_suffix(front.view());
+    } else
+    {
+        std::size_t back_window = window;
+        while (true)
+        {
+            // Streams can only be read from a byte aligned offset.
+            int64_t start = std::max<int64_t>(size - static_cast<int64_t>(back_window), 0);
+            start -= start % packed_size::value;
+
+            prefetch(helix, start, size - start);
+            helix.seek(start);
+            packed_sequence back(size - start);
+            for (auto buf = helix.read(); buf.size() > 0; buf = helix.read())
+                back.append(buf);
+
+            suffix = telomere_suffix(back.view());
+            if (suffix < static_cast<int64_t>(back.size()) || start == 0)
+                break;
+            back_window *= 2;
+        }
+    }
+
+    // the two runs may meet when there is nothing but telomere
+    suffix = std::min(suffix, size - prefix);
+
+    helix.seek(0);
+    return location{prefix, size - prefix - suffix};
+}
+
+} // dna
@@ -0,0 +1,127 @@
+#include "catch.hpp"
+#include "fake_stream.hpp"
+#include "test_sequences.hpp"
+#include <async_reader.hpp>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+using namespace dna;
+
+// A fake stream that takes delay to answer every read and can fail after a number of reads.
+class slow_stream
+{
+    fake_stream stream_;
+    std::chrono::milliseconds delay_;
+    int reads_left_;
+
+public:
+    slow_stream(const std::string& bases, std::size_t chunk_bytes, std::chrono::milliseconds delay,
+            int fail_after = -1)
+        : stream_(bases, chunk_bytes), delay_(delay), reads_left_(fail_after)
+    {}
+
+    void seek(long offset)
+    {
+        stream_.seek(offset);
+    }
+
+    long size() const
+    {
+        return stream_.size();
+    }
+
+    sequence_buffer<fake_stream::byte_view> read()
+    {
+        std::this_thread::sleep_for(delay_);
+        if (reads_left_ == 0)
+            throw std::runtime_error("connection reset");
+        if (reads_left_ > 0)
+            --reads_left_;
+        return stream_.read();
+    }
+};
+
+TEST_CASE("Given any depth and chunk size, the async reader returns every base in order")
+{
+    std::string bases = random_bases(100001, 1);
+    for (std::size_t depth : { 1, 2, 4 })
+        for (std::size_t chunk : { 4, 1000, 4099, 1 << 20 })
+        {
+            INFO("depth " << depth << " chunk " << chunk);
+            async_chunk_reader<fake_stream> reader(fake_stream(bases, 333), depth, chunk);
+            REQUIRE(reader.size() == 100001);
+
+            std::string read;
+            for (auto buf = reader.read(); buf.size() > 0; buf = reader.read())
+            {
+                if (read.size() + chunk < bases.size())
+                    REQUIRE(buf.size() >= chunk);
+                for (auto b : buf)
+                    read += to_char(b);
+            }
+            REQUIRE(read == bases);
+            REQUIRE(reader.read().size() == 0);
+        }
+}
+
+TEST_CASE("Seeking an async reader restarts it from the new offset")
+{
+    std::string bases = random_bases(50000, 2);
+    async_chunk_reader<fake_stream> reader(fake_stream(bases, 100), 2, 1024);
+    reader.read();
+
+    fake_stream rest(bases.substr(30000), 100), range(bases.substr(12345, 1000), 100), whole(bases, 100);
+    reader.seek(30000);
+    REQUIRE(read_packed(reader).bytes() == read_packed(rest).bytes());
+
+    REQUIRE(read_packed(reader, 12345, 1000).bytes() == read_packed(range).bytes());
+
+    reader.seek(0);
+    REQUIRE(read_packed(reader).bytes() == read_packed(whole).bytes());
+}
+
+TEST_CASE("Errors of the wrapped stream are rethrown after the chunks read before them")
+{
+    std::string bases = random_bases(10000, 3);
+    async_chunk_reader<slow_stream> reader(slow_stream(bases, 250, std::chrono::milliseconds(0), 3), 4, 1000);
+
+    std::size_t read = 0;
+    REQUIRE_THROWS_WITH([&]
+            {
+                for (auto buf = reader.read(); buf.size() > 0; buf = reader.read())
+                    read += buf.size();
+            }(), "connection reset");
+    REQUIRE(read == 3000);
+    REQUIRE(reader.read().size() == 0);
+}
+
+TEST_CASE("Given a slow stream, reading overlaps with processing the chunks")
+{
+    using namespace std::chrono;
+    const auto delay = milliseconds(20);
+    std::string bases = random_bases(8 * 4096, 4);
+
+    auto consume = [delay, &bases](auto& stream)
+    {
+        auto start = steady_clock::now();
+        std::size_t total = 0;
+        for (auto buf = stream.read(); buf.size() > 0; buf = stream.read())
+        {
+            total += buf.size();
+            std::this_thread::sleep_for(delay); // processing the chunk
+        }
+        REQUIRE(total == bases.size());
+        return duration_cast<milliseconds>(steady_clock::now() - start);
+    };
+
+    slow_stream direct(bases, 1024, delay);
+    auto serial = consume(direct);
+
+    async_chunk_reader<slow_stream> reader(slow_stream(bases, 1024, delay), 2, 4096);
+    auto overlapped = consume(reader);
+
+    // 8 chunks of 20ms reading and 20ms processing: ~320ms serially, ~180ms overlapped
+    INFO("serial " << serial.count() << "ms, overlapped " << overlapped.count() << "ms");
+    REQUIRE(overlapped.count() < serial.count() * 3 / 4);
+}
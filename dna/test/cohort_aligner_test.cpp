@@ -0,0 +1,155 @@
+#include "catch.hpp"
+#include "fake_person_factory.hpp"
+#include "fogsaa.hpp"
+#include "test_sequences.hpp"
+#include <cohort_aligner.hpp>
+#include <mutex>
+
+using namespace dna;
+using namespace std;
+
+static fake_person person_with_mutation(std::size_t chromosome, std::size_t byte)
+{
+    std::array<std::vector<std::byte>, 23> chromos;
+    for (auto& c : chromos)
+        c = data::fake();
+    chromos[chromosome][byte] = ~chromos[chromosome][byte];
+    return fake_person(chromos);
+}
+
+static fake_person person_with_telomeres(std::size_t repeats, std::size_t mutated_chromosome)
+{
+    std::string telomere;
+    for (std::size_t i = 0; i < repeats; ++i)
+        telomere += "CCCTAA";
+
+    std::array<std::string, 23> chromos;
+    for (std::size_t i = 0; i < chromos.size(); ++i)
+    {
+        std::string body = "G" + random_bases(4000, i);
+        if (i == mutated_chromosome)
+            body[1000] = body[1000] == 'A' ? 'C' : 'A';
+        chromos[i] = telomere + body;
+    }
+    return fake_person(chromos);
+}
+
+TEST_CASE("Given a cohort, every person should be compared against the reference once") {
+    fake_person reference = fake_person_factory::new_person_with_dup_chromos();
+    std::vector<fake_person> cohort;
+    cohort.push_back(fake_person_factory::new_person_with_dup_chromos());
+    cohort.push_back(fake_person_factory::new_person_with_dup_chromos_male());
+    cohort.push_back(fake_person_factory::new_person_with_dup_chromos());
+
+    thread_pool pool(4);
+    fogsaa_aligner<packed_stream> fogsaa;
+    cohort_aligner aligner(pool, fogsaa);
+
+    std::mutex lock;
+    std::vector<std::vector<alignment_result>> results(cohort.size());
+    std::vector<int> calls(cohort.size(), 0);
+    aligner.analyze_cohort_async(reference, cohort, [&](std::size_t index, std::vector<alignment_result>&& res)
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                results[index] = std::move(res);
+                ++calls[index];
+            }).get();
+
+    for (std::size_t p = 0; p < cohort.size(); ++p)
+    {
+        UNSCOPED_INFO("Person " << p);
+        REQUIRE(calls[p] == 1);
+        REQUIRE(results[p].size() == 23);
+
+        for (std::size_t i = 0; i < 23; ++i)
+        {
+            UNSCOPED_INFO("Chromosome " << i);
+            if (p == 1 && i == 22)
+            {
+                REQUIRE(results[p][i].error == dna::ChromoMismatchMFErr);
+            } else
+            {
+                REQUIRE(results[p][i].error.empty());
+                REQUIRE(results[p][i].mutations.size() == 0);
+                REQUIRE(results[p][i].similarity_score == 1);
+            }
+        }
+    }
+}
+
+TEST_CASE("Given a mutated person in a cohort, the mutation should match a pairwise alignment") {
+    fake_person reference = fake_person_factory::new_person_with_dup_chromos();
+    std::vector<fake_person> cohort;
+    cohort.push_back(person_with_mutation(4, 300));
+
+    thread_pool pool(2);
+    fogsaa_aligner<packed_stream> fogsaa;
+    cohort_aligner aligner(pool, fogsaa, 256, 64);
+
+    std::vector<alignment_result> results;
+    aligner.analyze_cohort_async(reference, cohort, [&](std::size_t, std::vector<alignment_result>&& res)
+            {
+                results = std::move(res);
+            }).get();
+
+    fake_stream s1 = reference.chromosome(4);
+    fake_stream s2 = cohort[0].chromosome(4);
+    alignment_result expected = fogsaa::align(s1, s2);
+
+    REQUIRE(results.size() == 23);
+    REQUIRE(results[4].mutations.size() > 0);
+    REQUIRE(results[4].mutations == expected.mutations);
+    REQUIRE(results[4].similarity_score == expected.similarity_score);
+    REQUIRE(results[3].mutations.size() == 0);
+}
+
+TEST_CASE("Given an empty cohort, the comparison should complete straight away") {
+    fake_person reference = fake_person_factory::new_person_with_dup_chromos();
+    std::vector<fake_person> cohort;
+
+    thread_pool pool(1);
+    fogsaa_aligner<packed_stream> fogsaa;
+    cohort_aligner aligner(pool, fogsaa);
+
+    int calls = 0;
+    aligner.analyze_cohort_async(reference, cohort, [&](std::size_t, std::vector<alignment_result>&&)
+            {
+                ++calls;
+            }).get();
+
+    REQUIRE(calls == 0);
+}
+
+TEST_CASE("Given telomeres of different lengths, they should be aligned like the rest of the chromosome") {
+    fake_person reference = person_with_telomeres(50, 23);
+    std::vector<fake_person> cohort;
+    cohort.push_back(person_with_telomeres(70, 2));
+
+    thread_pool pool(2);
+    fogsaa_aligner<packed_stream> fogsaa;
+    cohort_aligner aligner(pool, fogsaa, 256, 64);
+
+    std::vector<alignment_result> results;
+    aligner.analyze_cohort_async(reference, cohort, [&](std::size_t, std::vector<alignment_result>&& res)
+            {
+                results = std::move(res);
+            }).get();
+
+    REQUIRE(results.size() == 23);
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        UNSCOPED_INFO("Chromosome " << i);
+        fake_stream s1 = reference.chromosome(i);
+        fake_stream s2 = cohort[0].chromosome(i);
+        alignment_result expected = segmented_aligner<fake_stream>(fogsaa, nullptr, 256, 64).align(s1, s2);
+
+        REQUIRE(results[i].error.empty());
+        REQUIRE(results[i].mutations == expected.mutations);
+        REQUIRE(results[i].similarity_score == expected.similarity_score);
+
+        int64_t inserted = 0;
+        for (auto& mut : results[i].mutations)
+            inserted += mut.helix2.length - mut.helix1.length;
+        REQUIRE(inserted == 120);
+    }
+}
@@ -0,0 +1,121 @@
+#include "catch.hpp"
+#include <compact_result.hpp>
+#include <random>
+
+using namespace dna;
+
+static alignment_result random_result(std::size_t count, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    alignment_result res;
+    int64_t pos1 = 0, pos2 = 0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        pos1 += 1 + gen() % 2000;
+        pos2 = pos1 + static_cast<int64_t>(gen() % 7) - 3;
+        int64_t len1 = gen() % 4 == 0 ? gen() % 100000 : 1;
+        int64_t len2 = gen() % 4 == 0 ? gen() % 100 : 1;
+        res.mutations.emplace_back(location{pos1, len1}, location{pos2, len2});
+        pos1 += len1;
+    }
+    res.similarity_score = 0.875;
+    return res;
+}
+
+TEST_CASE("Varints round trip every magnitude")
+{
+    std::vector<std::byte> buf(16);
+    for (std::uint64_t value : { 0ULL, 1ULL, 127ULL, 128ULL, 300ULL, 1ULL << 35, ~0ULL })
+    {
+        std::byte* out = buf.data();
+        detail::put_varint(out, value);
+        REQUIRE(static_cast<std::size_t>(out - buf.data()) == detail::varint_size(value));
+
+        const std::byte* in = buf.data();
+        REQUIRE(detail::get_varint(in) == value);
+        REQUIRE(in == out);
+    }
+
+    for (int64_t value : { 0L, -1L, 1L, -64L, 64L, INT64_MIN, INT64_MAX })
+        REQUIRE(detail::unzigzag(detail::zigzag(value)) == value);
+    REQUIRE(detail::zigzag(-1) == 1);
+}
+
+TEST_CASE("Given any mutations, the compact result decodes the same mutations")
+{
+    result_arena arena(1024);
+    alignment_result res = random_result(5000, 1);
+    compact_result compact = compact_result::encode(res, arena);
+
+    REQUIRE(compact.size() == res.mutations.size());
+    REQUIRE(compact.similarity_score() == res.similarity_score);
+    REQUIRE(compact.error() == result_error::none);
+    REQUIRE(compact.message().empty());
+    REQUIRE(std::equal(compact.begin(), compact.end(), res.mutations.begin(), res.mutations.end()));
+
+    alignment_result decoded = compact.to_result();
+    REQUIRE(decoded.mutations == res.mutations);
+    REQUIRE(decoded.error.empty());
+
+    // mostly SNPs close together, far less than the 32 bytes of a mutation
+    REQUIRE(compact.encoded_bytes() < res.mutations.size() * 8);
+}
+
+TEST_CASE("Mutations out of order still round trip")
+{
+    alignment_result res;
+    res.mutations.emplace_back(location{5000, 1}, location{4000, 2});
+    res.mutations.emplace_back(location{10, 0}, location{9000, 3});
+    res.mutations.emplace_back(location{1LL << 40, 7}, location{0, 0});
+
+    result_arena arena;
+    REQUIRE(compact_result::encode(res, arena).to_result().mutations == res.mutations);
+}
+
+TEST_CASE("Known errors are kept as codes, others with their message")
+{
+    result_arena arena;
+    alignment_result res;
+
+    res.error = NoDataErr;
+    auto no_data = compact_result::encode(res, arena);
+    REQUIRE(no_data.error() == result_error::no_data);
+    REQUIRE(arena.bytes_used() == 0);
+
+    res.error = ChromoMismatchMFErr;
+    auto mismatch = compact_result::encode(res, arena);
+    REQUIRE(mismatch.error() == result_error::sex_chromosome_mismatch);
+    REQUIRE(mismatch.message() == ChromoMismatchMFErr);
+
+    res.error = "disk on fire";
+    auto other = compact_result::encode(res, arena);
+    REQUIRE(other.error() == result_error::other);
+    res.error.clear(); // the message lives in the arena
+    REQUIRE(other.message() == "disk on fire");
+    REQUIRE(other.to_result().error == "disk on fire");
+    REQUIRE(no_data.to_result().error == NoDataErr);
+    REQUIRE(compact_result().to_result().mutations.empty());
+}
+
+TEST_CASE("An arena holds many results and frees them at once")
+{
+    result_arena arena(4096);
+    std::vector<alignment_result> results;
+    std::vector<compact_result> compact;
+    for (unsigned i = 0; i < 23; ++i)
+    {
+        results.push_back(random_result(100 * i, i));
+        compact.push_back(compact_result::encode(results.back(), arena));
+    }
+
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < compact.size(); ++i)
+    {
+        REQUIRE(compact[i].to_result().mutations == results[i].mutations);
+        total += compact[i].encoded_bytes();
+    }
+    REQUIRE(arena.bytes_used() == total);
+
+    arena.clear();
+    REQUIRE(arena.bytes_used() == 0);
+}
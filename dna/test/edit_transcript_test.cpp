@@ -0,0 +1,48 @@
+#include "catch.hpp"
+#include "edit_transcript.hpp"
+
+using namespace dna;
+
+TEST_CASE("Given a transcript of only matches, no mutations should exist")
+{
+    edit_transcript transcript;
+    transcript.push(edit_op::match, 100);
+    transcript.push(edit_op::match, 50);
+
+    REQUIRE(transcript.runs().size() == 1);
+    REQUIRE(transcript.runs()[0].length == 150);
+    REQUIRE(transcript.mutations().empty());
+}
+
+TEST_CASE("Given adjacent mismatches and gaps, 1 mutation should exist")
+{
+    edit_transcript transcript;
+    transcript.push(edit_op::match, 10);
+    transcript.push(edit_op::mismatch);
+    transcript.push(edit_op::gap_helix1, 3);
+    transcript.push(edit_op::gap_helix2);
+    transcript.push(edit_op::match, 10);
+
+    auto muts = transcript.mutations();
+    REQUIRE(muts.size() == 1);
+
+    mutation mut{location{10,2}, location{10,4}};
+    REQUIRE(muts[0] == mut);
+}
+
+TEST_CASE("Given a transcript ending in a gap, the last mutation should reach the end")
+{
+    edit_transcript transcript;
+    transcript.push(edit_op::gap_helix2, 2);
+    transcript.push(edit_op::match, 5);
+    transcript.push(edit_op::gap_helix1, 4);
+
+    auto muts = transcript.mutations(100, 200);
+    REQUIRE(muts.size() == 2);
+
+    mutation mut{location{100,2}, location{200,0}};
+    REQUIRE(muts[0] == mut);
+
+    mutation mut2{location{107,0}, location{205,4}};
+    REQUIRE(muts[1] == mut2);
+}
@@ -1,4 +1,5 @@
 #include "fake_person_factory.hpp"
+#include <random>
 #include <vector>
 
 static const int rawdata[] = {
@@ -80,3 +81,23 @@ fake_person fake_person_factory::new_person_with_dup_chromos_male()
 
     return person;
 }
+
+// GRCh38 chromosome lengths in millions of base pairs, chromosome 23 is X.
+static const std::size_t chromosome_mb[] = {
+		248, 242, 198, 190, 181, 171, 159, 145, 138, 134, 135, 133,
+		114, 107, 102, 90, 83, 80, 59, 64, 47, 51, 156
+};
+
+fake_person fake_person_factory::new_person_with_realistic_chromos(std::size_t bytes_per_mb, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::array<std::vector<std::byte>, 23> chromos;
+    for (std::size_t i = 0; i < chromos.size(); ++i)
+    {
+        chromos[i].resize(chromosome_mb[i] * bytes_per_mb);
+        for (auto& b : chromos[i])
+            b = static_cast<std::byte>(rng() & 0xff);
+    }
+
+    return fake_person(chromos);
+}
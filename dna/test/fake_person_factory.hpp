@@ -7,6 +7,10 @@ class fake_person_factory
 public:
     static fake_person new_person_with_dup_chromos();
     static fake_person new_person_with_dup_chromos_male();
+
+    // Chromosomes sized in proportion to the human reference (chromosome 23 is an X), with
+    // bytes_per_mb bytes of data per million base pairs. Identical for identical seeds.
+    static fake_person new_person_with_realistic_chromos(std::size_t bytes_per_mb, unsigned seed = 1);
 };
 
 class data {
@@ -83,8 +83,9 @@ fake_stream& fake_stream::operator=(fake_stream&& other) noexcept
 
 void fake_stream::seek(long offset)
 {
-    // FIXME: with length fixes offset will not work properly if offset is mid byte
-	offset_.store(std::min(std::max(offset, 0L), static_cast<long>(len_)));
+    // offset is in bases, reads can only start on a byte so a mid byte offset is rounded down
+	auto bases = std::min(std::max(offset, 0L), static_cast<long>(len_));
+	offset_.store(bases / dna::packed_size::value);
 }
 
 long fake_stream::size() const
@@ -108,3 +109,26 @@ dna::sequence_buffer<fake_stream::byte_view> fake_stream::read()
     }
 	}
 }
+
+dna::sequence_buffer<dna::byte_span> fake_stream::read_view(std::size_t max_bytes)
+{
+	auto offset = offset_.load(std::memory_order_consume);
+	while (true)
+	{
+		auto size = std::min(max_bytes, data_.size() - offset);
+		if (size == 0)
+			return dna::sequence_buffer<dna::byte_span>(dna::byte_span(), 0);
+
+		if (offset_.compare_exchange_weak(offset, offset + size, std::memory_order_release))
+		{
+			size_t consumed = offset * dna::packed_size::value;
+			size_t len = std::min(len_ - consumed, size * dna::packed_size::value);
+			return dna::sequence_buffer<dna::byte_span>(dna::byte_span(data_.data() + offset, size), len);
+		}
+	}
+}
+
+void fake_stream::prefetch(long, long)
+{
+	// the data is already in memory
+}
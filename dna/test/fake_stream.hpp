@@ -46,6 +46,8 @@ public:
 	void seek(long offset);
 	long size() const;
 	dna::sequence_buffer<byte_view> read();
+	dna::sequence_buffer<dna::byte_span> read_view(std::size_t max_bytes);
+	void prefetch(long offset, long length);
 };
 
 
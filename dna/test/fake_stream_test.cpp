@@ -1,5 +1,6 @@
 #include "catch.hpp"
 #include "fake_person_factory.hpp"
+#include <packed_stream.hpp>
 #include <person.hpp>
 #include <iostream>
 
@@ -53,7 +54,7 @@ TEST_CASE("Fake stream is suitable for testing", "[stream]")
 	REQUIRE(endseq.size() == 496);
 	INFO(endseq);
 
-	stream.seek(1018);
+	stream.seek(1018 * dna::packed_size::value);
 	endseq = stream.read();
 	REQUIRE(endseq.size() == 8);
 	REQUIRE(endseq[0] == dna::G);
@@ -66,6 +67,28 @@ TEST_CASE("Fake stream is suitable for testing", "[stream]")
 	REQUIRE(endseq[7] == dna::C);
 }
 
+TEST_CASE("Fake stream lends views of its bytes", "[stream]")
+{
+	static_assert(dna::ChunkViewStream<fake_stream>);
+
+	auto data = data::fake();
+	fake_stream stream(data, 128);
+
+	auto first = stream.read_view(1000);
+	REQUIRE(first.size() == 4000);
+	REQUIRE(first.buffer().size() == 1000);
+	REQUIRE(first.buffer()[0] == data[0]);
+
+	auto rest = stream.read_view(1000);
+	REQUIRE(rest.size() == 80);
+	REQUIRE(rest.buffer().data() == first.buffer().data() + 1000);
+	REQUIRE(stream.read_view(1000).size() == 0);
+
+	stream.prefetch(0, stream.size());
+	stream.seek(0);
+	REQUIRE(dna::read_packed(stream).view().count_mismatches(dna::sequence_buffer(data)) == 0);
+}
+
 TEST_CASE("Fake person fulfills Person concept", "[stream]")
 {
   fake_person person = std::move(fake_person_factory::new_person_with_dup_chromos());
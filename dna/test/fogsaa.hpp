@@ -1,8 +1,20 @@
 #pragma once
 
+#include "edit_transcript.hpp"
+#include "packed_sequence.hpp"
+#include "packed_stream.hpp"
 #include "person.hpp"
+#include "scoring.hpp"
 #include "sequence_aligner.hpp"
-#include <string.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
 
 namespace dna
 {
@@ -10,129 +22,501 @@ namespace dna
 static const size_t BASE_S_OFFSET = 1;
 
 // FOGSAA based on the following whitepaper https://www.ncbi.nlm.nih.gov/pmc/articles/PMC3638164/#s1
+//
+// Scored by a ScoringPolicy, FOGSAA's own scores by default. Its bounds on the score still to
+// come assume linear gaps, a policy with a gap_open() is rejected.
 
-class fogsaa {
+namespace detail
+{
+
+// Best score of aligning x1 bases against x2 if every pair scores `score` and the bases left
+// over are gaps. FOGSAA's bounds assume linear gaps.
+template<ScoringPolicy Scoring>
+constexpr int64_t future_score_base(const Scoring& scoring, int64_t score, int64_t x1, int64_t x2)
+{
+    if (x2 < x1) {
+        return x2 * score + scoring.gap_extend() * (x1 - x2);
+    }
 
-    static const std::byte telemere_seq[6];
+    return x1 * score + scoring.gap_extend() * (x2 - x1);
+}
 
-    template<HelixStream T>
-    static constexpr sequence_buffer_iterator<T>consume_it(sequence_buffer<T>& seq, int64_t count)
+template<ScoringPolicy Scoring>
+constexpr int64_t fs_min(const Scoring& scoring, int64_t x1, int64_t x2)
+{
+    return future_score_base(scoring, worst_substitution(scoring), x1, x2);
+}
+
+template<ScoringPolicy Scoring>
+constexpr int64_t fs_max(const Scoring& scoring, int64_t x1, int64_t x2)
+{
+    return future_score_base(scoring, best_substitution(scoring), x1, x2);
+}
+
+enum pairing_type : char
+{
+    None,
+    Match,
+    MisMatch,
+    GapS1,
+    GapS2,
+};
+
+struct fitness_score
+{
+    int64_t min = 0;
+    int64_t max = 0;
+};
+
+// Position in an edit_path_tree: the first `length` operations of `segment` preceded by the
+// segment's ancestors. The empty path has no segment.
+struct path_ref
+{
+    int64_t segment = -1;
+    int64_t length = 0;
+};
+
+struct pairing
+{
+    fitness_score ft;
+    int64_t s1_offset = -1;
+    int64_t s2_offset = -1;
+    path_ref path; // path leading up to (not including) this pairing
+
+    int64_t score = std::numeric_limits<int64_t>::min();
+    pairing_type type = None;
+
+    bool operator() (const pairing& lhs, const pairing& rhs) const
+    {
+        if (lhs.ft.max < rhs.ft.max)
+            return true;
+        else if (lhs.ft.max == rhs.ft.max)
+            return lhs.ft.min < rhs.ft.min;
+        else
+            return false;
+    }
+
+    bool is_set() const
+    {
+        return type == None;
+    }
+};
+
+struct pairing_choice
+{
+    pairing non_gap;
+    pairing gap_s1;
+    pairing gap_s2;
+};
+
+struct pairing_key
+{
+    int64_t p1 = 0;
+    int64_t p2 = 0;
+
+    bool operator==(const pairing_key other) const
     {
-        auto it = seq.begin;
-        for(;count > 0; --count)
-            ++it;
+        return p1 == other.p1 && p2 == other.p2;
+    }
+};
 
-        return it;
+struct hash_pairing_key
+{
+    // std::hash<int64_t> is the identity, so mix both offsets (diagonal walks step p1 and p2
+    // together and would otherwise cancel out).
+    size_t operator() (const pairing_key& k) const {
+        uint64_t h = static_cast<uint64_t>(k.p1) * 0x9E3779B97F4A7C15ULL;
+        h ^= static_cast<uint64_t>(k.p2) * 0xC2B2AE3D27D4EB4FULL;
+        return static_cast<size_t>(h ^ (h >> 29));
     }
+};
 
-    // NOTE:!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-    // telemere stripping not properly implemented. Currnetly its matching bytes with single bp
-    // against bytes with 4 bp, this needs to be fixed.
-    template<HelixStream T>
-    static constexpr sequence_buffer_iterator<T> trim_telemere_front(T& helix, sequence_buffer<T>& seq)
+// Best fitness (ft.max) seen for each visited (s1, s2) cell. Similar strands keep the explored
+// cells close to the diagonal, so cells are stored in flat pages of rows (one row per s1
+// offset) that each hold a band of diagonals. A page's band is centered on the diagonal of the
+// first cell written into it and starts narrow; a cell written outside it widens the band of
+// its page (at least doubling it) up to max_half_width diagonals each side, so the band follows
+// the alignment as indels shift it. Cells further out, and scores that don't fit the 32 bit
+// cells, spill into a hash map.
+class score_cache
+{
+    static constexpr int32_t unset = std::numeric_limits<int32_t>::min();
+    static constexpr int32_t spilled = unset + 1; // the score is in spill_
+    static constexpr int64_t rows_per_page = 1024;
+
+    struct page
     {
-        const size_t t_size = sizeof(telemere_seq);
-        int64_t chromo_start = 0;
-        size_t offset = 0;
-        bool find_start = true;
+        int64_t center = 0;
+        int64_t half_width = 0;
+        std::unique_ptr<int32_t[]> cells;
 
-        while (true)
+        int64_t row_width() const
         {
-            seq = helix.read();
-            if (seq.size() == 0)
-                break;
+            return half_width * 2 + 1;
+        }
+    };
 
-            std::byte* buffer = (&(seq.buffer()[0])) + offset;
+    int64_t initial_half_width_;
+    int64_t max_half_width_;
+    std::vector<page> pages_;
+    std::unordered_map<pairing_key, int64_t, hash_pairing_key> spill_;
 
-            if (find_start)
-            {
-                // We could support trimming buffers smaller then the t_size, but that makes trimming
-                // more complicated. In practice we will never have a buffer smaller then t_size having
-                // telemeres so this should not be an issue.
-                if (seq.size() < t_size)
-                {
-                    return seq.begin();
-                }
+    static int32_t* band_cell(const page& pg, int64_t p1, int64_t p2)
+    {
+        int64_t band_offset = (p2 - p1) - pg.center + pg.half_width;
+        if (band_offset < 0 || band_offset >= pg.row_width())
+            return nullptr;
 
-                for (size_t g=0; g < t_size; ++g)
-                {
-                    if (memcmp(buffer+g, telemere_seq, t_size) == 0)
-                    {
-                        if (g > 0)
-                            find_start = !(memcmp(buffer, telemere_seq + t_size - g, g) == 0);// check for partial match
-                        else
-                            find_start = false;
-
-                        offset = g + t_size;
-                        chromo_start = g + t_size;
-                        buffer = buffer + chromo_start;
-                        break;
-                    }
-                }
+        return &pg.cells[(p1 % rows_per_page) * pg.row_width() + band_offset];
+    }
 
-                if (find_start)
-                {
-                    return seq.begin(); // no telemeres found at start of strand
-                }
+    static void allocate(page& pg, int64_t half_width)
+    {
+        page wider{pg.center, half_width, std::make_unique<int32_t[]>(rows_per_page * (half_width * 2 + 1))};
+        std::fill(wider.cells.get(), wider.cells.get() + rows_per_page * wider.row_width(), unset);
+        if (pg.cells)
+        {
+            for (int64_t row = 0; row < rows_per_page; ++row)
+                std::copy(&pg.cells[row * pg.row_width()], &pg.cells[(row + 1) * pg.row_width()],
+                        &wider.cells[row * wider.row_width() + half_width - pg.half_width]);
+        }
+        pg = std::move(wider);
+    }
+
+public:
+    score_cache(int64_t rows, int64_t initial_half_width = 2, int64_t max_half_width = 256)
+        : initial_half_width_(initial_half_width),
+          max_half_width_(std::max(max_half_width, initial_half_width)),
+          pages_(rows / rows_per_page + 1)
+    {}
+
+    // Returns the stored score or std::numeric_limits<int64_t>::min() if the cell was never visited.
+    int64_t get(int64_t p1, int64_t p2) const
+    {
+        const page& pg = pages_[p1 / rows_per_page];
+        int32_t* cell = pg.cells ? band_cell(pg, p1, p2) : nullptr;
+        if (cell != nullptr && *cell != spilled)
+            return *cell == unset ? std::numeric_limits<int64_t>::min() : *cell;
+
+        auto existing = spill_.find(pairing_key{p1, p2});
+        return existing == spill_.end() ? std::numeric_limits<int64_t>::min() : existing->second;
+    }
+
+    void set(int64_t p1, int64_t p2, int64_t score)
+    {
+        page& pg = pages_[p1 / rows_per_page];
+        if (!pg.cells)
+        {
+            pg.center = p2 - p1;
+            allocate(pg, initial_half_width_);
+        }
+
+        int32_t* cell = band_cell(pg, p1, p2);
+        if (cell == nullptr)
+        {
+            int64_t needed = std::abs((p2 - p1) - pg.center);
+            if (needed <= max_half_width_)
+            {
+                allocate(pg, std::min(std::max(pg.half_width * 2, needed), max_half_width_));
+                cell = band_cell(pg, p1, p2);
             }
+        }
+
+        if (cell != nullptr && score > spilled && score <= std::numeric_limits<int32_t>::max())
+        {
+            *cell = static_cast<int32_t>(score);
+            return;
+        }
+
+        if (cell != nullptr)
+            *cell = spilled;
+        spill_[pairing_key{p1, p2}] = score;
+    }
+};
 
-            size_t size = seq.size() - offset;
-            size_t limit = ((size / t_size) * t_size) + 1;
-            for (size_t i = 0; i < limit; i = i + t_size)
+// Every path explored by the aligner, stored as a tree of run length encoded segments. Paths
+// that branch off share their common prefix, and a path that keeps making the same kind of
+// pairing just grows its segment's run, so memory follows the number of differences and
+// branches explored instead of the length of the helixes.
+class edit_path_tree
+{
+    struct segment
+    {
+        path_ref parent;
+        pairing_type type;
+        int64_t run;
+    };
+
+    std::vector<segment> segments_;
+
+public:
+    // Appends a pairing to the path ending at `at` and returns the extended path.
+    path_ref append(path_ref at, pairing_type type)
+    {
+        if (at.segment >= 0)
+        {
+            segment& seg = segments_[at.segment];
+            if (seg.type == type && seg.run == at.length)
             {
-                if (memcmp(buffer + i, telemere_seq, std::min(limit - i, t_size)) != 0)
-                    return consume_it(seq, chromo_start);
-                chromo_start += t_size;
+                ++seg.run;
+                return path_ref{at.segment, at.length + 1};
             }
+        }
+
+        segments_.push_back(segment{at, type, 1});
+        return path_ref{static_cast<int64_t>(segments_.size()) - 1, 1};
+    }
 
-            offset = size - limit - 1; // TODO: do i need -1 here?
+    edit_transcript transcript(path_ref at) const
+    {
+        std::vector<edit_run> reversed;
+        for (; at.segment >= 0; at = segments_[at.segment].parent)
+        {
+            switch (segments_[at.segment].type)
+            {
+                case Match:
+                    reversed.push_back(edit_run{edit_op::match, at.length});
+                    break;
+                case MisMatch:
+                    reversed.push_back(edit_run{edit_op::mismatch, at.length});
+                    break;
+                case GapS1:
+                    reversed.push_back(edit_run{edit_op::gap_helix1, at.length});
+                    break;
+                default:
+                    reversed.push_back(edit_run{edit_op::gap_helix2, at.length});
+                    break;
+            }
         }
 
-        return consume_it(seq, chromo_start);
+        edit_transcript result;
+        for (auto it = reversed.rbegin(); it != reversed.rend(); ++it)
+            result.push(it->op, it->length);
+        return result;
     }
+};
 
-    template<HelixStream T>
-    static void trim_telemere_end(std::vector<std::byte>& vec)
+template<ScoringPolicy Scoring>
+class byte_aligner
+{
+    using queue = std::priority_queue<pairing, std::vector<pairing>, pairing>;
+    Scoring scoring_;
+    sequence_buffer<byte_span> s1_;
+    sequence_buffer<byte_span> s2_;
+
+    edit_path_tree paths_;
+    path_ref best_path_;
+
+    pairing_choice eval_pairing_choices(const int64_t score, path_ref path, int64_t p1, int64_t p2) const
     {
-        // TODO: implement
+        int64_t s1_sz = s1_.size(), s2_sz = s2_.size();
+        pairing_choice result;
+
+        // compare
+        int64_t p1n = p1 + 1, p2n = p2 + 1;
+        base b1 = s1_[p1n - BASE_S_OFFSET], b2 = s2_[p2n - BASE_S_OFFSET];
+        result.non_gap.type = b1 == b2 ? Match : MisMatch;
+
+        int64_t x1 = s2_sz - p2n, x2 = s1_sz - p1n;
+        int64_t score_nxt = score + scoring_.substitution(b1, b2);
+        result.non_gap.score = score_nxt;
+        result.non_gap.s1_offset = p1n;
+        result.non_gap.s2_offset = p2n;
+        result.non_gap.ft = fitness_score{score_nxt + fs_min(scoring_, x1, x2),  score_nxt + fs_max(scoring_, x1, x2)};
+        result.non_gap.path = path;
+
+        score_nxt = score + scoring_.gap_extend();
+
+        // gap s1
+        x1 = s2_sz - p2n, x2 = s1_sz - p1;
+        result.gap_s1.score = score_nxt;
+        result.gap_s1.s1_offset = p1;
+        result.gap_s1.s2_offset = p2n;
+        result.gap_s1.ft = fitness_score{score_nxt + fs_min(scoring_, x1, x2), score_nxt + fs_max(scoring_, x1, x2)};
+        result.gap_s1.type = GapS1;
+        result.gap_s1.path = path;
+
+        // gap s2
+        x1 = s2_sz - p2, x2 = s1_sz - p1n;
+         result.gap_s2.score = score_nxt;
+        result.gap_s2.s1_offset = p1n;
+        result.gap_s2.s2_offset = p2;
+        result.gap_s2.ft = fitness_score{score_nxt + fs_min(scoring_, x1, x2), score_nxt + fs_max(scoring_, x1, x2)};
+        result.gap_s2.type = GapS2;
+        result.gap_s2.path = path;
+
+        return result;
     }
 
-    template<HelixStream T>
-    static constexpr void fill_helix_vector(T& helix, std::vector<std::byte>& vec)
+    static bool is_candidate(const score_cache& cache, const pairing& pairing, int64_t best_score)
     {
-        vec.reserve(helix.size() + BASE_S_OFFSET);
-        for (size_t i = 0; i < BASE_S_OFFSET; ++i)
-            vec.emplace_back(static_cast<std::byte>(0));
+        if (pairing.ft.max < best_score)
+            return false;
 
-        //bool trim_start = true;
+        return cache.get(pairing.s1_offset, pairing.s2_offset) < pairing.ft.max;
+    }
 
-        while (true)
+    static void process_candidates(
+            bool has_candidate, pairing& cur_pairing, pairing& other,queue& pri, int64_t best_min)
+    {
+        if (!has_candidate)
+        {
+            cur_pairing = other;
+        }
+        else if (cur_pairing.ft.max < other.ft.max)
+        {
+            pri.push(cur_pairing);
+            cur_pairing = other;
+        } else if (!(  other.ft.max < cur_pairing.ft.min
+                    || other.ft.max < best_min))
+        {
+            pri.push(other);
+        }
+    }
+
+public:
+    byte_aligner(const sequence_buffer<byte_span>& s1, const sequence_buffer<byte_span>& s2,
+            const Scoring& scoring = Scoring())
+        : scoring_(scoring), s1_(s1), s2_(s2)
+    {
+        if constexpr (constant_gap_scores<Scoring>::value)
+            static_assert(Scoring::gap_open() == 0, "FOGSAA only scores linear gaps");
+        else if (scoring_.gap_open() != 0)
+            throw std::invalid_argument("FOGSAA only scores linear gaps");
+    }
+
+    // Offsets into the helixes are 1 based while aligning, 0 being the position before the
+    // first base.
+    void run_alignment() {
+        int64_t best_score = std::numeric_limits<int64_t>::min();
+        int64_t best_min = std::numeric_limits<int64_t>::min();
+        score_cache best_fit_scores(s1_.size() + BASE_S_OFFSET);
+        // TODO: replace queue vector with map or max heap
+        queue pri_queue;
+        pairing cur_pairing;
+        int64_t s1_sz = s1_.size(), s2_sz = s2_.size();
+
+        pairing_choice choice = eval_pairing_choices(0, path_ref{}, 0, 0);
+        pri_queue.push(choice.non_gap);
+        pri_queue.push(choice.gap_s1);
+        pri_queue.push(choice.gap_s2);
+
+        while (!pri_queue.empty())
         {
-            auto seq = helix.read();
-            if (seq.size() == 0)
-                return;
-
-            auto it = seq.begin();
-            //if (trim_start)
-            //{
-                //it = trim_telemere_front(helix, seq);
-                //trim_start = false;
-            //}
-
-            auto end = seq.end();
-            for (; it != end; ++it)
+            cur_pairing = pri_queue.top();
+            pri_queue.pop();
+
+            if (cur_pairing.ft.max <= best_score)
+                break; // we are done, top of queue max can't beat best score
+
+            bool has_candidate = true;
+            while (has_candidate)
             {
-                vec.emplace_back(static_cast<std::byte>(*it));
+                best_fit_scores.set(cur_pairing.s1_offset, cur_pairing.s2_offset, cur_pairing.ft.max);
+                path_ref path = paths_.append(cur_pairing.path, cur_pairing.type);
+
+                if (cur_pairing.s1_offset == s1_sz || cur_pairing.s2_offset == s2_sz)
+                {
+                    best_score = cur_pairing.score;
+                    best_min = std::max(cur_pairing.ft.min, best_min);
+
+                    for (int64_t i = cur_pairing.s1_offset; i < s1_sz; ++i)
+                    {
+                        path = paths_.append(path, GapS2);
+                        best_score -= scoring_.gap_extend();
+                    }
+
+                    for (int64_t i = cur_pairing.s2_offset; i < s2_sz; ++i)
+                    {
+                        path = paths_.append(path, GapS1);
+                        best_score -= scoring_.gap_extend();
+                    }
+
+                    best_path_ = path;
+                    break;
+                }
+
+                choice = eval_pairing_choices(
+                        cur_pairing.score,
+                        path,
+                        cur_pairing.s1_offset,
+                        cur_pairing.s2_offset);
+                has_candidate = is_candidate(best_fit_scores, choice.non_gap, best_score);
+                if (has_candidate)
+                    cur_pairing = choice.non_gap;
+
+                if (is_candidate(best_fit_scores, choice.gap_s2, best_score))
+                {
+                    process_candidates(has_candidate, cur_pairing, choice.gap_s2, pri_queue, best_min);
+                    has_candidate = true;
+                }
+
+                if (is_candidate(best_fit_scores, choice.gap_s1, best_score))
+                {
+                    process_candidates(has_candidate, cur_pairing, choice.gap_s1, pri_queue, best_min);
+                    has_candidate = true;
+                }
             }
         }
+
+    }
+
+    alignment_result get_alignment() const
+    {
+        std::vector<mutation> muts = transcript().mutations();
+        double total_muts = 0;
+        for (auto& mut : muts)
+            total_muts += mut.helix1.length;
+
+        // TODO: Better way to score?
+        alignment_result result(
+            std::move(muts),
+            std::move(std::string("")),
+            1 - (total_muts / std::max(s1_.size(), s2_.size())));
+        return result;
+    }
+
+    edit_transcript transcript() const
+    {
+        return paths_.transcript(best_path_);
+    }
+};
+
+} // detail
+
+class fogsaa {
+
+    template<ScoringPolicy Scoring>
+    static alignment_result align_packed(const sequence_buffer<byte_span>& s1, const sequence_buffer<byte_span>& s2,
+            const Scoring& scoring)
+    {
+        detail::byte_aligner<Scoring> aligner(s1, s2, scoring);
+        aligner.run_alignment();
+        return aligner.get_alignment();
     }
 
-    static alignment_result align_bytes(
-            const std::vector<std::byte>& s1, const std::vector<std::byte>& s2);
 public:
 
-    template<HelixStream T>
-    static alignment_result align(T& stream1, T& stream2)
+    // Aligns two already loaded helixes and returns the edit operations of the best alignment.
+    template<ScoringPolicy Scoring = fogsaa_scoring>
+    static edit_transcript transcribe(const sequence_buffer<byte_span>& s1, const sequence_buffer<byte_span>& s2,
+            const Scoring& scoring = Scoring())
+    {
+        if (s1.size() == 0 || s2.size() == 0)
+        {
+            edit_transcript transcript;
+            transcript.push(edit_op::gap_helix2, s1.size());
+            transcript.push(edit_op::gap_helix1, s2.size());
+            return transcript;
+        }
+
+        detail::byte_aligner<Scoring> aligner(s1, s2, scoring);
+        aligner.run_alignment();
+        return aligner.transcript();
+    }
+
+    template<ScoringPolicy Scoring = fogsaa_scoring, HelixStream T>
+    static alignment_result align(T& stream1, T& stream2, const Scoring& scoring = Scoring())
     {
         if (stream1.size() == 0 && stream2.size() == 0)
         {
@@ -144,28 +528,24 @@ public:
         if (stream1.size() == 0 || stream2.size() == 0)
         {
             alignment_result res;
-            res.error = "A stream did not have data";
+            res.error = NoDataErr;
             return res;
         }
 
-        std::vector<std::byte> s1;
-        std::vector<std::byte> s2;
-
-        fill_helix_vector(stream1, s1);
-        fill_helix_vector(stream2, s2);
-
-        return align_bytes(s1, s2);
+        return align_packed(read_helix(stream1).view(), read_helix(stream2).view(), scoring);
     }
 };
 
-template<HelixStream T>
+template<HelixStream T, ScoringPolicy Scoring = fogsaa_scoring>
 class fogsaa_aligner : public sequence_aligner<T>
 {
+    Scoring scoring_;
+
 public:
-    fogsaa_aligner() {};
+    explicit fogsaa_aligner(const Scoring& scoring = Scoring()) : scoring_(scoring) {};
 
     alignment_result align(T& a, T&b) const override {
-        return fogsaa::align(a, b);
+        return fogsaa::align(a, b, scoring_);
     }
 };
 
@@ -218,3 +218,66 @@ TEST_CASE("Given two stands with same large fake data, no mutations should exist
     REQUIRE(res.mutations.size() == 0);
     REQUIRE(res.similarity_score == 1.0);
 }
+
+// Strands of A and C only. An insertion of G and T can't match any of their bases, so it has
+// a single optimal placement instead of being split among co-optimal ones.
+static const std::string insertion_prefix = "ACCAAAAACAACCACACAACACACACACCAACACAAAACCCACCAACCCAACACAAACCACCCAAAAACCAAACAAACA";
+static const std::string insertion_suffix = "CAACACACACACCCCCACCCACCACACCCACCCCACCAAACCAACACCCCCACCACACCCAAAAACAAAACCCAAACAACC";
+
+TEST_CASE("Given two strands where one has a long insertion, 1 mutation should exist")
+{
+    fake_stream s1(insertion_prefix + insertion_suffix, 512);
+    fake_stream s2(insertion_prefix + "TTGTGTGGTGTGGGTGTGGGGGGG" + insertion_suffix, 512);
+
+    alignment_result res = fogsaa::align(s1, s2);
+    REQUIRE(res.mutations.size() == 1);
+    REQUIRE(res.mutations[0] == (mutation{location{79, 0}, location{79, 24}}));
+}
+
+TEST_CASE("Given two strands where one has an insertion wider than the score band, 1 mutation should exist")
+{
+    std::string insertion;
+    for (int i = 0; i < 300; ++i)
+        insertion += "GT"[(i * 7 + i / 5) % 2];
+    fake_stream s1(insertion_prefix + insertion_suffix, 512);
+    fake_stream s2(insertion_prefix + insertion + insertion_suffix, 512);
+
+    alignment_result res = fogsaa::align(s1, s2);
+    REQUIRE(res.mutations.size() == 1);
+    REQUIRE(res.mutations[0] == (mutation{location{79, 0}, location{79, 300}}));
+}
+
+TEST_CASE("Given a scoring policy, FOGSAA aligns by its scores")
+{
+    // Gaps so cheap that a mismatch is better aligned as a gap in each strand.
+    using cheap_gaps = linear_scoring<1, -5, -1>;
+    fake_stream a("ACGTTCGA", 512), b("ACGATCGA", 512);
+    packed_sequence s1 = read_packed(a), s2 = read_packed(b);
+
+    auto count = [](const edit_transcript& transcript, edit_op op)
+    {
+        int64_t total = 0;
+        for (auto& run : transcript.runs())
+            total += run.op == op ? run.length : 0;
+        return total;
+    };
+
+    auto by_default = fogsaa::transcribe(s1.view(), s2.view());
+    REQUIRE(count(by_default, edit_op::mismatch) == 1);
+    REQUIRE(count(by_default, edit_op::gap_helix1) == 0);
+
+    auto by_policy = fogsaa::transcribe(s1.view(), s2.view(), cheap_gaps());
+    REQUIRE(count(by_policy, edit_op::mismatch) == 0);
+    REQUIRE(count(by_policy, edit_op::gap_helix1) == 1);
+    REQUIRE(count(by_policy, edit_op::gap_helix2) == 1);
+
+    // Scores set at run time align the same, as long as the gaps are linear.
+    auto at_run_time = fogsaa::transcribe(s1.view(), s2.view(), runtime_scoring(cheap_gaps()));
+    REQUIRE(at_run_time.mutations() == by_policy.mutations());
+    REQUIRE_THROWS_AS(fogsaa::transcribe(s1.view(), s2.view(), runtime_scoring(1, -1, -3, -1)),
+            std::invalid_argument);
+
+    fake_stream c("ACGTTCGA", 512), d("ACGATCGA", 512);
+    fogsaa_aligner<fake_stream, cheap_gaps> aligner;
+    REQUIRE(aligner.align(c, d).mutations == by_policy.mutations());
+}
@@ -0,0 +1,188 @@
+#include "catch.hpp"
+#include "fogsaa.hpp"
+#include "fake_stream.hpp"
+#include "test_sequences.hpp"
+#include <hirschberg_aligner.hpp>
+
+using namespace dna;
+
+// Score of an alignment, FOGSAA's by default.
+template<ScoringPolicy S = fogsaa_scoring>
+static int64_t score(const edit_transcript& transcript, const std::string& a, const std::string& b,
+        const S& scoring = S())
+{
+    int64_t total = 0, i = 0, j = 0;
+    for (auto& run : transcript.runs())
+        for (int64_t k = 0; k < run.length; ++k)
+            switch (run.op)
+            {
+            case edit_op::gap_helix1:
+                total += scoring.gap_extend();
+                ++j;
+                break;
+            case edit_op::gap_helix2:
+                total += scoring.gap_extend();
+                ++i;
+                break;
+            default:
+                total += scoring.substitution(from_char(a[i++]), from_char(b[j++]));
+            }
+    return total;
+}
+
+// Best score of any alignment, by the full matrix.
+template<ScoringPolicy S>
+static int64_t needleman_wunsch(const std::string& a, const std::string& b, const S& scoring)
+{
+    std::vector<std::vector<int64_t>> h(a.size() + 1, std::vector<int64_t>(b.size() + 1));
+    for (std::size_t i = 0; i <= a.size(); ++i)
+        for (std::size_t j = 0; j <= b.size(); ++j)
+        {
+            if (i == 0 || j == 0)
+            {
+                h[i][j] = static_cast<int64_t>(i + j) * scoring.gap_extend();
+                continue;
+            }
+            h[i][j] = std::max({ h[i - 1][j - 1] + scoring.substitution(from_char(a[i - 1]), from_char(b[j - 1])),
+                    h[i - 1][j] + scoring.gap_extend(), h[i][j - 1] + scoring.gap_extend() });
+        }
+    return h[a.size()][b.size()];
+}
+
+TEST_CASE("Given indels, Hirschberg alignment scores as well as FOGSAA at any split depth")
+{
+    for (unsigned seed = 0; seed < 10; ++seed)
+    {
+        std::string bases = random_bases(400, seed);
+        std::string mutated = mutate(bases, 10, seed + 100);
+        auto s1 = pack_string(bases), s2 = pack_string(mutated);
+
+        int64_t expected = score(fogsaa::transcribe(s1.view(), s2.view()), bases, mutated);
+        for (int64_t leaf_cells : { 1 << 20, 1 << 10, 4 })
+        {
+            edit_transcript transcript = hirschberg_engine(nullptr, leaf_cells).transcribe(s1.view(), s2.view());
+            REQUIRE(score(transcript, bases, mutated) == expected);
+
+            // The transcript still spells out the two strands.
+            int64_t len1 = 0, len2 = 0;
+            for (auto& run : transcript.runs())
+            {
+                len1 += run.op == edit_op::gap_helix1 ? 0 : run.length;
+                len2 += run.op == edit_op::gap_helix2 ? 0 : run.length;
+            }
+            REQUIRE(len1 == static_cast<int64_t>(bases.size()));
+            REQUIRE(len2 == static_cast<int64_t>(mutated.size()));
+        }
+    }
+}
+
+TEST_CASE("Given a pool, Hirschberg alignment finds the same alignment as on one thread")
+{
+    std::string bases = random_bases(3000, 7);
+    std::string mutated = mutate(bases, 30, 8);
+    auto s1 = pack_string(bases), s2 = pack_string(mutated);
+
+    thread_pool pool(4);
+    auto whole = hirschberg_engine(nullptr, 1 << 24).transcribe(s1.view(), s2.view());
+    auto serial = hirschberg_engine(nullptr, 1 << 12).transcribe(s1.view(), s2.view());
+    auto parallel = hirschberg_engine(&pool, 1 << 12).transcribe(s1.view(), s2.view());
+
+    REQUIRE(score(serial, bases, mutated) == score(whole, bases, mutated));
+    REQUIRE(parallel.mutations() == serial.mutations());
+}
+
+TEST_CASE("Given a substitution matrix, Hirschberg alignment finds the best score")
+{
+    using scoring = transition_scoring<2, -1, -3, 0, -3>;
+    for (unsigned seed = 0; seed < 10; ++seed)
+    {
+        std::string bases = random_bases(300, seed + 30);
+        std::string mutated = mutate(bases, 10, seed + 400);
+        auto s1 = pack_string(bases), s2 = pack_string(mutated);
+
+        int64_t expected = needleman_wunsch(bases, mutated, scoring());
+        for (int64_t leaf_cells : { 1 << 20, 4 })
+        {
+            auto transcript = hirschberg_engine<scoring>(nullptr, leaf_cells).transcribe(s1.view(), s2.view());
+            REQUIRE(score(transcript, bases, mutated, scoring()) == expected);
+
+            // Scores set at run time find the same alignment.
+            auto runtime = hirschberg_engine<runtime_scoring>(nullptr, leaf_cells, runtime_scoring(scoring()))
+                .transcribe(s1.view(), s2.view());
+            REQUIRE(runtime.mutations() == transcript.mutations());
+        }
+    }
+}
+
+TEST_CASE("Given scores too large for 32 bits, Hirschberg alignment still finds the best score")
+{
+    // A pass over more than 21 bases can't be scored in 32 bits with these.
+    using scoring = linear_scoring<100000000, -100000000, -100000000>;
+    thread_pool pool(2);
+    for (unsigned seed = 0; seed < 5; ++seed)
+    {
+        std::string bases = random_bases(400, seed + 50);
+        std::string mutated = mutate(bases, 12, seed + 500);
+        auto s1 = pack_string(bases), s2 = pack_string(mutated);
+
+        int64_t expected = needleman_wunsch(bases, mutated, scoring());
+        for (int64_t leaf_cells : { 1 << 20, 64 })
+        {
+            auto transcript = hirschberg_engine<scoring>(&pool, leaf_cells).transcribe(s1.view(), s2.view());
+            REQUIRE(score(transcript, bases, mutated, scoring()) == expected);
+        }
+    }
+}
+
+TEST_CASE("Given alignments running on the pool that splits them, none of them deadlock")
+{
+    thread_pool pool(2);
+    hirschberg_aligner<fake_stream> aligner(&pool, 256);
+    std::string bases = random_bases(2000, 11);
+    std::string mutated = mutate(bases, 20, 12);
+
+    std::vector<std::future<alignment_result>> results;
+    for (int i = 0; i < 6; ++i)
+        results.push_back(pool.enqueue([&aligner, &bases, &mutated]
+                {
+                    fake_stream a(bases, 512), b(mutated, 512);
+                    return aligner.align(a, b);
+                }));
+
+    fake_stream a(bases, 512), b(mutated, 512);
+    alignment_result expected = hirschberg_aligner<fake_stream>(nullptr, 256).align(a, b);
+    for (auto& res : results)
+        REQUIRE(res.get().mutations == expected.mutations);
+}
+
+TEST_CASE("Given affine gaps, Hirschberg alignment refuses to score them")
+{
+    using affine = affine_scoring<1, -1, -3, -1>;
+    REQUIRE_THROWS_AS(hirschberg_engine<affine>(), std::invalid_argument);
+}
+
+TEST_CASE("Given point mutations, Hirschberg alignment agrees with FOGSAA")
+{
+    std::string bases = random_bases(4000, 2);
+    std::string mutated = bases;
+    for (std::size_t i : { 0, 700, 701, 2500, 3999 })
+        mutated[i] = other_base(mutated[i]);
+
+    fake_stream a1(bases, 512), a2(mutated, 512), b1(bases, 512), b2(mutated, 512);
+    hirschberg_aligner<fake_stream> aligner(nullptr, 1 << 14);
+    alignment_result res = aligner.align(a1, a2);
+    alignment_result expected = fogsaa::align(b1, b2);
+
+    REQUIRE(res.mutations.size() == 4);
+    REQUIRE(res.mutations == expected.mutations);
+    REQUIRE(res.similarity_score == expected.similarity_score);
+}
+
+TEST_CASE("Given an empty strand, Hirschberg alignment reports an error")
+{
+    hirschberg_aligner<fake_stream> aligner;
+    fake_stream empty1("", 512), empty2("", 512), full("ACGT", 512);
+
+    REQUIRE(aligner.align(empty1, empty2).similarity_score == 1);
+    REQUIRE(aligner.align(full, empty1).error == NoDataErr);
+}
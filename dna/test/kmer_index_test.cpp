@@ -0,0 +1,145 @@
+#include "catch.hpp"
+#include "fake_stream.hpp"
+#include "test_sequences.hpp"
+#include <anchor_chain.hpp>
+#include <kmer_index.hpp>
+#include <packed_stream.hpp>
+#include <cstring>
+#include <sstream>
+
+using namespace dna;
+
+static uint64_t pack_kmer(const std::string& bases)
+{
+    uint64_t kmer = 0;
+    for (char c : bases)
+        kmer = (kmer << 2) | static_cast<uint64_t>(std::string("ACGT").find(c));
+    return kmer;
+}
+
+TEST_CASE("Every window of w k-mers holds a minimizer")
+{
+    std::string bases = random_bases(20000, 1);
+    packed_sequence seq = pack_string(bases);
+
+    for (uint32_t k : { 8u, 21u, 32u })
+    {
+        INFO("k " << k);
+        kmer_index index(k, 16);
+        std::vector<int64_t> offsets;
+        index.for_each_minimizer(seq.view(), [&](int64_t offset, uint64_t kmer)
+                {
+                    REQUIRE(kmer == pack_kmer(bases.substr(offset, k)));
+                    offsets.push_back(offset);
+                });
+
+        REQUIRE(offsets.front() < 16);
+        REQUIRE(offsets.back() + 16 > static_cast<int64_t>(bases.size() - k));
+        for (std::size_t i = 1; i < offsets.size(); ++i)
+        {
+            REQUIRE(offsets[i] > offsets[i - 1]);
+            REQUIRE(offsets[i] - offsets[i - 1] <= 16);
+        }
+
+        // roughly 2 / (w + 1) of the k-mers are sampled
+        REQUIRE(offsets.size() > bases.size() / 17);
+        REQUIRE(offsets.size() < bases.size() / 4);
+    }
+}
+
+TEST_CASE("Given a query window, the index returns where it starts")
+{
+    std::string bases = random_bases(200000, 2);
+    kmer_index index(pack_string(bases).view(), 24, 12);
+    REQUIRE(index.length() == 200000);
+    REQUIRE(index.size() > 0);
+
+    std::string exact = bases.substr(123457, 600);
+    auto hits = index.candidates(pack_string(exact).view());
+    REQUIRE_FALSE(hits.empty());
+    REQUIRE(hits.front().offset == 123457);
+
+    // mutations only cost the votes of the minimizers they touch
+    std::string mutated = exact;
+    mutated[100] = mutated[100] == 'A' ? 'C' : 'A';
+    mutated[400] = mutated[400] == 'A' ? 'C' : 'A';
+    mutated.erase(250, 2);
+    hits = index.candidates(pack_string(mutated).view());
+    REQUIRE_FALSE(hits.empty());
+    REQUIRE(hits.front().offset == 123457);
+
+    REQUIRE(index.candidates(pack_string(random_bases(600, 3)).view()).empty());
+}
+
+TEST_CASE("Repeated k-mers do not vote beyond max_occurrences")
+{
+    std::string repeat = random_bases(100, 4);
+    std::string bases;
+    for (int i = 0; i < 10; ++i)
+        bases += repeat + random_bases(500, 10 + i);
+    kmer_index index(pack_string(bases).view(), 16, 8);
+
+    auto all = index.candidates(pack_string(repeat).view());
+    REQUIRE(all.size() == 10);
+    REQUIRE(index.candidates(pack_string(repeat).view(), 5).empty());
+}
+
+TEST_CASE("An index reads back what was saved")
+{
+    std::string bases = random_bases(50000, 5);
+    kmer_index index(pack_string(bases).view(), 20, 10);
+
+    std::stringstream file;
+    index.save(file);
+    kmer_index loaded = kmer_index::load(file);
+
+    REQUIRE(loaded.k() == 20);
+    REQUIRE(loaded.w() == 10);
+    REQUIRE(loaded.length() == index.length());
+    REQUIRE(loaded.size() == index.size());
+
+    auto query = pack_string(bases.substr(31000, 300));
+    auto expected = index.candidates(query.view());
+    auto actual = loaded.candidates(query.view());
+    REQUIRE(actual.size() == expected.size());
+    REQUIRE(actual.front().offset == 31000);
+    REQUIRE(actual.front().hits == expected.front().hits);
+
+    std::stringstream garbage("not an index at all");
+    REQUIRE_THROWS_AS(kmer_index::load(garbage), std::runtime_error);
+
+    std::string saved = file.str();
+    std::stringstream truncated(saved.substr(0, saved.size() - 10));
+    REQUIRE_THROWS_AS(kmer_index::load(truncated), std::runtime_error);
+
+    // A corrupt entry count is refused before anything is allocated for it.
+    std::string corrupt = saved;
+    std::uint64_t count = 1ULL << 60;
+    std::memcpy(&corrupt[24], &count, sizeof(count));
+    std::stringstream huge(corrupt);
+    REQUIRE_THROWS_AS(kmer_index::load(huge), std::runtime_error);
+}
+
+TEST_CASE("Anchors found through a k-mer index chain like sampled ones")
+{
+    std::string bases = random_bases(100000, 6);
+    std::string other = bases;
+    other.insert(30000, "ACGTACGTAC");
+    other.erase(70000, 7);
+    packed_sequence s1 = pack_string(bases), s2 = pack_string(other);
+
+    anchor_finder finder;
+    kmer_index index(s1.view());
+    auto anchors = anchor_finder::chain(finder.find(index, s2.view()));
+    REQUIRE(anchors.size() > 1000);
+    for (auto& a : anchors)
+        REQUIRE(bases.substr(a.helix1, anchor_length) == other.substr(a.helix2, anchor_length));
+
+    auto segments = finder.plan(index, s2.view(), 20000);
+    REQUIRE(segments.size() > 1);
+    REQUIRE(segments.front().helix1.offset == 0);
+    REQUIRE(segments.back().helix1.offset + segments.back().helix1.length == 100000);
+    REQUIRE(segments.back().helix2.offset + segments.back().helix2.length == 100003);
+
+    REQUIRE_THROWS_AS(finder.find(kmer_index(s1.view(), 16), s2.view()), std::invalid_argument);
+}
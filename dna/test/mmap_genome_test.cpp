@@ -0,0 +1,173 @@
+#include "catch.hpp"
+#include "fake_person.hpp"
+#include "fogsaa.hpp"
+#include "test_sequences.hpp"
+#include <mmap_genome.hpp>
+#include <packed_stream.hpp>
+#include <cstdio>
+
+using namespace dna;
+
+// Chromosomes of every length mod 4, including an empty one, read in chunks that don't end
+// on a byte.
+static std::array<std::string, 23> chromosome_bases()
+{
+    std::array<std::string, 23> chromos;
+    for (std::size_t i = 0; i < chromos.size(); ++i)
+        chromos[i] = random_bases(i == 5 ? 0 : 1000 + i * 3001, i + 1);
+    return chromos;
+}
+
+// Removes the file when it goes out of scope.
+struct temp_file
+{
+    std::string path;
+
+    explicit temp_file(std::string name) : path(std::move(name))
+    {
+        std::remove(path.c_str());
+    }
+
+    ~temp_file()
+    {
+        std::remove(path.c_str());
+    }
+};
+
+TEST_CASE("Given a person written to a genome file, the mapped person reads the same bases")
+{
+    temp_file file("mmap_genome_test.genome");
+    auto chromos = chromosome_bases();
+    fake_person person(chromos, 97);
+    write_genome(person, file.path);
+
+    mmap_person mapped(file.path, 4096 + 3);
+    REQUIRE(mapped.chromosomes() == 23);
+    for (std::size_t i = 0; i < chromos.size(); ++i)
+    {
+        INFO("chromosome " << i);
+        auto helix = mapped.chromosome(i);
+        REQUIRE(helix.size() == static_cast<long>(chromos[i].size()));
+        REQUIRE(unpack(read_packed(helix)) == chromos[i]);
+    }
+
+    REQUIRE_THROWS_AS(mapped.chromosome(23), std::invalid_argument);
+}
+
+TEST_CASE("Mapped chunks are views of the file's pages")
+{
+    temp_file file("mmap_genome_views.genome");
+    auto chromos = chromosome_bases();
+    fake_person person(chromos);
+    write_genome(person, file.path);
+
+    mmap_person mapped(file.path, 1024);
+    auto a = mapped.chromosome(7), b = mapped.chromosome(7);
+    auto first = a.read();
+    REQUIRE(first.size() == 1024);
+    REQUIRE(b.read().buffer().data() == first.buffer().data());
+
+    // chromosomes start on their own page
+    for (std::size_t i : { 0, 1, 22 })
+    {
+        auto helix = mapped.chromosome(i);
+        auto address = reinterpret_cast<std::uintptr_t>(helix.read().buffer().data());
+        REQUIRE(address % genome_page_size == 0);
+    }
+
+    // an earlier chunk is still valid after later reads
+    auto second = a.read();
+    REQUIRE(second.buffer().data() == first.buffer().data() + 1024 / packed_size::value);
+    REQUIRE(to_char(first[0]) == chromos[7][0]);
+
+    a.seek(2050);
+    auto sought = a.read();
+    REQUIRE(to_char(sought[0]) == chromos[7][2048]);
+    a.seek(1L << 40);
+    REQUIRE(a.read().size() == 0);
+
+    // views are not limited to the chunk size
+    static_assert(ChunkViewStream<mmap_helix_stream>);
+    a.seek(0);
+    a.prefetch(0, a.size());
+    auto view = a.read_view(1 << 20);
+    REQUIRE(view.size() == chromos[7].size());
+    REQUIRE(view.buffer().data() == first.buffer().data());
+}
+
+TEST_CASE("Aligners read mapped chromosomes without copying them")
+{
+    temp_file file("mmap_genome_lent.genome");
+    auto chromos = chromosome_bases();
+    fake_person person(chromos);
+    write_genome(person, file.path);
+
+    static_assert(WholeViewStream<mmap_helix_stream>);
+    mmap_person mapped(file.path, 1024);
+    auto helix = mapped.chromosome(7);
+    auto first = mapped.chromosome(7).read();
+
+    // the bases outlive the stream they were lent by
+    helix_bases bases = read_helix(helix);
+    helix = mmap_helix_stream();
+    REQUIRE(bases.size() == chromos[7].size());
+    REQUIRE(bases.view().buffer().data() == first.buffer().data());
+    REQUIRE(to_char(bases.view()[chromos[7].size() - 1]) == chromos[7].back());
+
+    // streams that can't lend their bases are read into a copy
+    fake_stream copied(chromos[7], 1000);
+    helix_bases read = read_helix(copied);
+    REQUIRE(read.size() == chromos[7].size());
+    for (std::size_t i = 0; i < chromos[7].size(); ++i)
+        REQUIRE(to_char(read.view()[i]) == chromos[7][i]);
+}
+
+TEST_CASE("Given a file that is not a packed genome, mapping it throws")
+{
+    temp_file file("mmap_genome_bad.genome");
+    REQUIRE_THROWS_AS(mmap_person(file.path), std::system_error);
+
+    {
+        std::ofstream out(file.path, std::ios::binary);
+        out << "definitely not a genome";
+    }
+    REQUIRE_THROWS_AS(mmap_person(file.path), std::runtime_error);
+
+    // a header claiming more bases than the file holds
+    auto chromos = chromosome_bases();
+    fake_person person(chromos);
+    write_genome(person, file.path);
+    {
+        std::fstream out(file.path, std::ios::binary | std::ios::in | std::ios::out);
+        genome_header header;
+        out.read(reinterpret_cast<char*>(&header), sizeof(header));
+        header.chromosomes[22].bases += 1 << 20;
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+    REQUIRE_THROWS_WITH(mmap_person(file.path), GenomeFormatErr);
+}
+
+TEST_CASE("Mapped people align like the people they were written from")
+{
+    temp_file file("mmap_genome_align.genome");
+    auto chromos = chromosome_bases();
+    fake_person person(chromos);
+    write_genome(person, file.path);
+
+    std::string mutated = chromos[2];
+    mutated[1234] = mutated[1234] == 'A' ? 'C' : 'A';
+
+    mmap_person mapped(file.path);
+    auto helix = mapped.chromosome(2);
+    fake_stream other(mutated, 512);
+    auto s1 = std::make_shared<const packed_sequence>(read_packed(helix));
+    auto s2 = std::make_shared<const packed_sequence>(read_packed(other));
+    packed_stream h1(s1), h2(s2);
+
+    fogsaa_aligner<packed_stream> fogsaa;
+    auto res = fogsaa.align(h1, h2);
+    REQUIRE(res.error.empty());
+    REQUIRE(res.mutations.size() == 1);
+    REQUIRE(res.mutations[0] == mutation(location{1234, 1}, location{1234, 1}));
+}
@@ -0,0 +1,191 @@
+#include "catch.hpp"
+#include <mutation_file.hpp>
+#include <thread_pool.hpp>
+#include <cstring>
+#include <random>
+#include <sstream>
+
+using namespace dna;
+
+// Mutations spread evenly over size bases of helix 1.
+static alignment_result random_result(std::size_t count, int64_t size, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    alignment_result res;
+    int64_t step = size / static_cast<int64_t>(count + 1);
+    int64_t drift = 0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        int64_t pos = static_cast<int64_t>(i + 1) * step + gen() % (step / 2);
+        int64_t len1 = gen() % 3, len2 = gen() % 3;
+        res.mutations.emplace_back(location{pos, len1}, location{pos + drift, len2});
+        drift += len2 - len1;
+    }
+    res.similarity_score = 1 - static_cast<double>(count) / size;
+    return res;
+}
+
+TEST_CASE("Given results written to a mutation file, they read back unchanged")
+{
+    std::stringstream file;
+    std::vector<alignment_result> written;
+    {
+        mutation_file_writer writer(file, 100);
+        for (unsigned person = 0; person < 3; ++person)
+            for (unsigned chromosome = 0; chromosome < 23; ++chromosome)
+            {
+                written.push_back(random_result(chromosome * 17, 1 << 20, person * 23 + chromosome));
+                writer.write(person, chromosome, written.back());
+            }
+        writer.finish();
+        REQUIRE_THROWS_AS(writer.write(0, 0, written.front()), std::logic_error);
+    }
+
+    mutation_file_reader reader(file);
+    for (unsigned person = 0; person < 3; ++person)
+        for (unsigned chromosome = 0; chromosome < 23; ++chromosome)
+        {
+            INFO("person " << person << " chromosome " << chromosome);
+            alignment_result res = reader.read(person, chromosome);
+            const alignment_result& expected = written[person * 23 + chromosome];
+            REQUIRE(res.mutations == expected.mutations);
+            REQUIRE(res.similarity_score == expected.similarity_score);
+            REQUIRE(res.error.empty());
+        }
+
+    // results are split into blocks of at most 100 mutations
+    for (auto& block : reader.blocks())
+        REQUIRE(block.count <= 100);
+    REQUIRE(reader.blocks().size() > 3 * 23);
+    REQUIRE_THROWS_AS(reader.read(3, 0), std::out_of_range);
+}
+
+TEST_CASE("Errors are written with the result they belong to")
+{
+    std::stringstream file;
+    mutation_file_writer writer(file);
+    alignment_result mismatch, other;
+    mismatch.error = ChromoMismatchMFErr;
+    other.error = "stream reset by peer";
+    writer.write(1, 22, mismatch);
+    writer.write(2, 5, other);
+    writer.finish();
+
+    mutation_file_reader reader(file);
+    REQUIRE(reader.read(1, 22).error == ChromoMismatchMFErr);
+    REQUIRE(reader.read(2, 5).error == "stream reset by peer");
+    REQUIRE(reader.blocks()[0].error == result_error::sex_chromosome_mismatch);
+}
+
+TEST_CASE("Scanning a region only reads the blocks that may overlap it")
+{
+    std::stringstream file;
+    std::vector<alignment_result> results;
+    {
+        mutation_file_writer writer(file, 64);
+        for (unsigned person = 0; person < 10; ++person)
+        {
+            results.push_back(random_result(1000, 1 << 24, person));
+            writer.write(person, 7, results.back());
+            writer.write(person, 8, random_result(1000, 1 << 24, person + 100));
+        }
+        writer.finish();
+    }
+
+    mutation_file_reader reader(file);
+    const location region{5000000, 100000};
+    std::vector<std::pair<std::uint64_t, mutation>> found;
+    reader.scan(7, region, [&found](std::uint64_t person, const mutation& mut)
+            {
+                found.emplace_back(person, mut);
+            });
+
+    std::size_t expected = 0;
+    for (std::size_t person = 0; person < results.size(); ++person)
+        for (auto& mut : results[person].mutations)
+        {
+            if (mut.helix1.offset < region.offset + region.length
+                    && mut.helix1.offset + std::max<int64_t>(mut.helix1.length, 1) > region.offset)
+            {
+                ++expected;
+                REQUIRE(std::find(found.begin(), found.end(), std::make_pair(person, mut)) != found.end());
+            }
+        }
+    REQUIRE(found.size() == expected);
+    REQUIRE(expected > 0);
+
+    // 16 blocks per person and chromosome, the region falls in one or two of each person's
+    REQUIRE(reader.blocks().size() == 2 * 10 * 16);
+    REQUIRE(reader.blocks_read() <= 2 * 10);
+}
+
+TEST_CASE("Results can be written concurrently as they complete")
+{
+    std::stringstream file;
+    mutation_file_writer writer(file, 50);
+    {
+        thread_pool pool(4);
+        std::vector<std::future<void>> done;
+        for (unsigned chromosome = 0; chromosome < 23; ++chromosome)
+            done.push_back(pool.enqueue([&writer, chromosome]
+                    {
+                        writer.write(0, chromosome, random_result(200, 1 << 20, chromosome));
+                    }));
+        for (auto& f : done)
+            f.get();
+    }
+    writer.finish();
+
+    mutation_file_reader reader(file);
+    for (unsigned chromosome = 0; chromosome < 23; ++chromosome)
+        REQUIRE(reader.read(0, chromosome).mutations == random_result(200, 1 << 20, chromosome).mutations);
+}
+
+TEST_CASE("Given a file that is not a finished mutation file, reading it throws")
+{
+    std::stringstream garbage("this is not a mutation file at all");
+    REQUIRE_THROWS_AS(mutation_file_reader(garbage), std::runtime_error);
+
+    std::stringstream unfinished;
+    mutation_file_writer writer(unfinished);
+    writer.write(0, 0, random_result(10, 1000, 1));
+    REQUIRE_THROWS_WITH(mutation_file_reader(unfinished), MutationFileErr);
+}
+
+// Overwrites the value at pos bytes into the first index entry of a finished file.
+template<typename T>
+static std::string patch_index(std::string file, std::size_t pos, T value)
+{
+    std::uint64_t index;
+    std::memcpy(&index, file.data() + file.size() - 16, sizeof(index));
+    std::memcpy(&file[index + sizeof(std::uint64_t) + pos], &value, sizeof(value));
+    return file;
+}
+
+TEST_CASE("Given a corrupt index, reading it throws instead of allocating what it claims")
+{
+    std::stringstream out;
+    mutation_file_writer writer(out);
+    writer.write(0, 0, random_result(10, 1000, 1));
+    writer.finish();
+    const std::string file = out.str();
+
+    const std::size_t count = 12, message = 57, offset = 61, column_bytes = 69;
+    for (auto corrupt : {
+            patch_index(file, message, std::uint32_t{0xffffffff}),
+            patch_index(file, offset, std::uint64_t{1} << 40),
+            patch_index(file, column_bytes, std::uint32_t{0xffffffff}),
+            patch_index(file, column_bytes + 12, std::uint32_t{0xffffffff}),
+            patch_index(file, count, std::uint32_t{0xffffffff}),
+            patch_index(file, std::size_t{0} - sizeof(std::uint64_t), std::uint64_t{1} << 60)})
+    {
+        std::stringstream in(corrupt);
+        REQUIRE_THROWS_WITH(mutation_file_reader(in), MutationFileErr);
+    }
+
+    std::stringstream in(file);
+    mutation_file_reader reader(in);
+    auto block = reader.blocks().front();
+    block.count = block.column_bytes[0] + 1;
+    REQUIRE_THROWS_WITH(reader.read_block(block), MutationFileErr);
+}
@@ -0,0 +1,103 @@
+#include "catch.hpp"
+#include <array>
+#include <deque>
+#include "packed_sequence.hpp"
+
+TEST_CASE("Can push bases into a packed sequence", "[packedseq]")
+{
+	dna::packed_sequence seq;
+	seq.push_back(dna::G);
+	seq.push_back(dna::A);
+	seq.push_back(dna::C);
+	seq.push_back(dna::T);
+	seq.push_back(dna::C);
+
+	REQUIRE(seq.size() == 5);
+	REQUIRE(seq.bytes().size() == 2);
+	REQUIRE(seq.bytes()[0] == dna::pack(dna::G, dna::A, dna::C, dna::T));
+	REQUIRE(seq[4] == dna::C);
+}
+
+TEST_CASE("Can append sequence buffers at any phase", "[packedseq]")
+{
+	std::array<std::byte, 3> data = {
+			dna::pack(dna::G, dna::A, dna::C, dna::T),
+			dna::pack(dna::A, dna::A, dna::G, dna::C),
+			dna::pack(dna::T, dna::G, dna::A, dna::A),
+	};
+	dna::sequence_buffer buf(data, 10);
+
+	for (std::size_t lead = 0; lead < dna::packed_size::value; ++lead)
+	{
+		dna::packed_sequence seq;
+		for (std::size_t i = 0; i < lead; ++i)
+			seq.push_back(dna::T);
+
+		seq.append(buf);
+		seq.append(buf);
+
+		REQUIRE(seq.size() == lead + 20);
+		for (std::size_t i = 0; i < 20; ++i)
+			REQUIRE(seq[lead + i] == buf[i % 10]);
+	}
+}
+
+TEST_CASE("Byte aligned appends copy whole bytes and clear the bases past the end", "[packedseq]")
+{
+	std::array<std::byte, 3> data = {
+			dna::pack(dna::G, dna::A, dna::C, dna::T),
+			dna::pack(dna::A, dna::A, dna::G, dna::C),
+			dna::pack(dna::T, dna::G, dna::A, dna::A),
+	};
+	std::deque<std::byte> scattered(data.begin(), data.end());
+
+	dna::packed_sequence contiguous, copied;
+	contiguous.append(dna::sequence_buffer(data, 10), 4, 5);
+	copied.append(dna::sequence_buffer(scattered, 10), 4, 5);
+
+	for (auto seq : { &contiguous, &copied })
+	{
+		REQUIRE(seq->size() == 5);
+		REQUIRE(seq->bytes().size() == 2);
+		REQUIRE(seq->bytes()[0] == data[1]);
+		REQUIRE(seq->bytes()[1] == dna::pack(dna::T, dna::A, dna::A, dna::A));
+
+		seq->push_back(dna::C);
+		REQUIRE((*seq)[5] == dna::C);
+		REQUIRE((*seq)[6] == dna::A);
+	}
+}
+
+TEST_CASE("A packed sequence can be viewed as a sequence buffer", "[packedseq]")
+{
+	std::vector<std::byte> data(100);
+	for (std::size_t i = 0; i < data.size(); ++i)
+		data[i] = static_cast<std::byte>(i * 13);
+	dna::sequence_buffer<std::vector<std::byte>> buf(data);
+
+	dna::packed_sequence seq;
+	seq.append(buf);
+
+	auto view = seq.view();
+	REQUIRE(view.size() == buf.size());
+	REQUIRE(view.count_mismatches(buf) == 0);
+}
+
+TEST_CASE("Can drop bases from the front of a packed sequence", "[packedseq]")
+{
+	std::vector<std::byte> data(20);
+	for (std::size_t i = 0; i < data.size(); ++i)
+		data[i] = static_cast<std::byte>(i * 29);
+	dna::sequence_buffer<std::vector<std::byte>> buf(data);
+
+	dna::packed_sequence seq;
+	seq.append(buf);
+	seq.erase_front(7);
+
+	REQUIRE(seq.size() == buf.size() - 7);
+	for (std::size_t i = 0; i < seq.size(); ++i)
+		REQUIRE(seq[i] == buf[i + 7]);
+
+	seq.erase_front(seq.size());
+	REQUIRE(seq.empty());
+}
@@ -0,0 +1,188 @@
+#include "catch.hpp"
+#include <partial_result.hpp>
+#include <algorithm>
+#include <random>
+
+using namespace dna;
+
+// A whole helix pair alignment, mutations separated by at least one matching base.
+static alignment_result random_whole(std::size_t count, unsigned seed, int64_t& len1, int64_t& len2)
+{
+    std::mt19937 gen(seed);
+    alignment_result res;
+    int64_t pos1 = 0, pos2 = 0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        int64_t gap = 1 + gen() % 50;
+        pos1 += gap;
+        pos2 += gap;
+        int64_t l1 = 1 + gen() % 5;
+        int64_t l2 = gen() % 6;
+        res.mutations.emplace_back(location{pos1, l1}, location{pos2, l2});
+        pos1 += l1;
+        pos2 += l2;
+    }
+    int64_t tail = 1 + gen() % 50;
+    len1 = pos1 + tail;
+    len2 = pos2 + tail;
+    return res;
+}
+
+// Cuts a whole alignment at the helix 1 offsets in cuts, splitting the mutations that span a
+// cut the way separate segment aligners could have reported them.
+static std::vector<partial_result> cut(const alignment_result& whole, int64_t len1, int64_t len2,
+        std::vector<int64_t> cuts)
+{
+    // Where each cut falls in helix 2.
+    std::vector<int64_t> cuts2;
+    for (int64_t c1 : cuts)
+    {
+        int64_t c2 = c1;
+        for (auto& mut : whole.mutations)
+        {
+            if (mut.helix1.offset >= c1)
+                break;
+            if (mut.helix1.offset + mut.helix1.length <= c1)
+                c2 = c1 + (mut.helix2.offset + mut.helix2.length) - (mut.helix1.offset + mut.helix1.length);
+            else
+                c2 = mut.helix2.offset + std::min(c1 - mut.helix1.offset, mut.helix2.length);
+        }
+        cuts2.push_back(c2);
+    }
+
+    cuts.insert(cuts.begin(), 0);
+    cuts.push_back(len1);
+    cuts2.insert(cuts2.begin(), 0);
+    cuts2.push_back(len2);
+
+    std::vector<partial_result> parts;
+    for (std::size_t i = 0; i + 1 < cuts.size(); ++i)
+    {
+        segment seg{location{cuts[i], cuts[i + 1] - cuts[i]}, location{cuts2[i], cuts2[i + 1] - cuts2[i]}};
+        alignment_result res;
+        for (auto& mut : whole.mutations)
+        {
+            int64_t start1 = std::max(mut.helix1.offset, seg.helix1.offset);
+            int64_t end1 = std::min(mut.helix1.offset + mut.helix1.length, seg.helix1.offset + seg.helix1.length);
+            if (start1 >= end1)
+                continue;
+            int64_t start2 = std::max(mut.helix2.offset, seg.helix2.offset);
+            int64_t end2 = std::min(mut.helix2.offset + mut.helix2.length, seg.helix2.offset + seg.helix2.length);
+            res.mutations.emplace_back(location{start1 - seg.helix1.offset, end1 - start1},
+                    location{start2 - seg.helix2.offset, std::max<int64_t>(end2 - start2, 0)});
+        }
+        parts.emplace_back(seg, std::move(res));
+    }
+    return parts;
+}
+
+static void require_same(const partial_result& merged, const partial_result& whole)
+{
+    REQUIRE(merged.helix1 == whole.helix1);
+    REQUIRE(merged.helix2 == whole.helix2);
+    REQUIRE(merged.matched == whole.matched);
+    REQUIRE(merged.substituted == whole.substituted);
+    REQUIRE(merged.inserted == whole.inserted);
+    REQUIRE(merged.deleted == whole.deleted);
+    REQUIRE(merged.mutations == whole.mutations);
+    REQUIRE(merged.to_result().similarity_score == whole.to_result().similarity_score);
+}
+
+TEST_CASE("A partial result counts the bases of its segment")
+{
+    alignment_result res;
+    res.mutations.emplace_back(location{2, 1}, location{2, 1}); // SNP
+    res.mutations.emplace_back(location{5, 3}, location{5, 1}); // deletion of 2
+    res.mutations.emplace_back(location{10, 0}, location{8, 4}); // insertion of 4
+    partial_result part(segment{location{100, 20}, location{200, 22}}, std::move(res));
+
+    REQUIRE(part.matched == 16);
+    REQUIRE(part.substituted == 2);
+    REQUIRE(part.deleted == 2);
+    REQUIRE(part.inserted == 4);
+    REQUIRE(part.mutations[1] == mutation(location{105, 3}, location{205, 1}));
+    REQUIRE(!part.open_front());
+    REQUIRE(!part.open_back());
+}
+
+TEST_CASE("Given segment results in any order and grouping, merging gives the whole result")
+{
+    int64_t len1, len2;
+    alignment_result whole = random_whole(60, 3, len1, len2);
+    partial_result expected(segment{location{0, len1}, location{0, len2}}, alignment_result(whole));
+
+    std::mt19937 gen(11);
+    for (int round = 0; round < 20; ++round)
+    {
+        std::vector<int64_t> cuts;
+        for (int i = 0; i < 8; ++i)
+            cuts.push_back(1 + gen() % (len1 - 1));
+        std::sort(cuts.begin(), cuts.end());
+        cuts.erase(std::unique(cuts.begin(), cuts.end()), cuts.end());
+        auto parts = cut(whole, len1, len2, cuts);
+
+        // Folded in a shuffled order.
+        std::shuffle(parts.begin(), parts.end(), gen);
+        require_same(merge_all(parts), expected);
+
+        // Reduced as a tree of arbitrarily grouped neighbours.
+        std::sort(parts.begin(), parts.end(), [](auto& a, auto& b) { return a.helix1.offset < b.helix1.offset; });
+        while (parts.size() > 1)
+        {
+            std::size_t i = gen() % (parts.size() - 1);
+            partial_result pair = gen() % 2 ? merge(parts[i], parts[i + 1]) : merge(parts[i + 1], parts[i]);
+            parts[i] = std::move(pair);
+            parts.erase(parts.begin() + i + 1);
+        }
+        require_same(parts[0], expected);
+    }
+}
+
+TEST_CASE("Given a mutation split by a cut, merging joins it back")
+{
+    alignment_result left, right;
+    left.mutations.emplace_back(location{8, 2}, location{8, 2});
+    right.mutations.emplace_back(location{0, 3}, location{0, 0});
+    partial_result a(segment{location{0, 10}, location{0, 10}}, std::move(left));
+    partial_result b(segment{location{10, 10}, location{10, 7}}, std::move(right));
+    REQUIRE(a.open_back());
+    REQUIRE(b.open_front());
+
+    partial_result merged = merge(b, a);
+    REQUIRE(merged.mutations.size() == 1);
+    REQUIRE(merged.mutations[0] == mutation(location{8, 5}, location{8, 2}));
+    REQUIRE(merged.substituted == 2);
+    REQUIRE(merged.deleted == 3);
+    REQUIRE(merged.matched == 15);
+}
+
+TEST_CASE("The empty partial result is the identity of merge")
+{
+    alignment_result res;
+    res.mutations.emplace_back(location{1, 1}, location{1, 1});
+    partial_result part(segment{location{50, 10}, location{60, 10}}, std::move(res));
+
+    require_same(merge(partial_result(), part), part);
+    require_same(merge(part, partial_result()), part);
+    REQUIRE(merge_all({}).to_result().similarity_score == 1);
+}
+
+TEST_CASE("Merging keeps the first error in helix order")
+{
+    alignment_result first, second;
+    first.error = "first";
+    second.error = NoDataErr;
+    partial_result a(segment{location{0, 10}, location{0, 10}}, std::move(first));
+    partial_result b(segment{location{10, 10}, location{10, 10}}, std::move(second));
+    partial_result c(segment{location{20, 10}, location{20, 10}}, alignment_result());
+
+    REQUIRE(merge_all({c, b, a}).to_result().error == "first");
+    REQUIRE(merge(c, b).to_result().error == NoDataErr);
+}
+
+TEST_CASE("Partial results that don't meet can't be merged")
+{
+    partial_result a(segment{location{0, 10}, location{0, 10}}, alignment_result());
+    partial_result b(segment{location{11, 10}, location{10, 10}}, alignment_result());
+    REQUIRE_THROWS_AS(merge(a, b), std::invalid_argument);
+}
@@ -12,37 +12,47 @@ class threaded_alignment_forker : public AlignmentForker<T> {
     sequence_aligner<T>& aligner_;
     thread_pool& pool_;
 
+    using completion = typename AlignmentForker<T>::completion;
+
     class align_closure
     {
         sequence_aligner<T>& aligner_;
         T a_;
         T b_;
+        completion on_done_;
 
     public:
-        align_closure(sequence_aligner<T>& aligner, T&& a, T&& b)
-            : aligner_(aligner), a_(std::move(a)), b_(std::move(b))
+        align_closure(sequence_aligner<T>& aligner, T&& a, T&& b, completion&& on_done)
+            : aligner_(aligner), a_(std::move(a)), b_(std::move(b)), on_done_(std::move(on_done))
         {}
 
-        alignment_result do_align()
+        void do_align()
         {
-            return aligner_.align(a_, b_);
+            alignment_result res;
+            try {
+                res = aligner_.align(a_, b_);
+            } catch (const std::exception& e) {
+                res.error = e.what();
+            }
+            on_done_(std::move(res));
         }
     };
 
-    static alignment_result align_main(align_closure* closure)
+    static void align_main(align_closure* closure)
     {
-        alignment_result res = closure->do_align();
+        closure->do_align();
         delete closure;
-        return res;
     }
 
 public:
     explicit threaded_alignment_forker(thread_pool& pool, sequence_aligner<T>& aligner)
         : pool_(pool), aligner_(aligner) {}
 
-    future<alignment_result> spawn_alignment(T&& a, T&& b) override {
-        auto closure = new align_closure(aligner_, std::move(a), std::move(b));
-        return pool_.enqueue(align_main, closure);
+    using AlignmentForker<T>::spawn_alignment;
+
+    void spawn_alignment(T&& a, T&& b, completion on_done) override {
+        auto closure = new align_closure(aligner_, std::move(a), std::move(b), std::move(on_done));
+        pool_.enqueue(align_main, closure);
     }
 };
 
@@ -53,7 +63,7 @@ TEST_CASE("Given two male people with exact dna match, no mutations should be fo
     thread_pool pool(std::thread::hardware_concurrency());
     fogsaa_aligner<fake_stream> fogsaa;
     threaded_alignment_forker<fake_stream> forker(pool, fogsaa);
-    pairwise_aligner<fake_stream> aligner(pool, forker);
+    pairwise_aligner<fake_stream> aligner(forker);
     auto results = aligner.analyze_people_async(bob, john).get();
 
     REQUIRE(results.size() == 23);
@@ -76,7 +86,7 @@ TEST_CASE("Given one male and one female, chromosome 23 should have error") {
     thread_pool pool(std::thread::hardware_concurrency());
     fogsaa_aligner<fake_stream> fogsaa;
     threaded_alignment_forker<fake_stream> forker(pool, fogsaa);
-    pairwise_aligner<fake_stream> aligner(pool, forker);
+    pairwise_aligner<fake_stream> aligner(forker);
     auto results = aligner.analyze_people_async(bob, alice).get();
 
     REQUIRE(results.size() == 23);
@@ -99,3 +109,80 @@ TEST_CASE("Given one male and one female, chromosome 23 should have error") {
         ++i;
     }
 }
+
+TEST_CASE("Given a single worker, concurrent comparisons should all complete") {
+    fake_person bob = std::move(fake_person_factory::new_person_with_dup_chromos());
+    fake_person john = std::move(fake_person_factory::new_person_with_dup_chromos());
+    fake_person alice = std::move(fake_person_factory::new_person_with_dup_chromos());
+
+    thread_pool pool(1);
+    fogsaa_aligner<fake_stream> fogsaa;
+    threaded_alignment_forker<fake_stream> forker(pool, fogsaa);
+    pairwise_aligner<fake_stream> aligner(forker);
+
+    auto first = aligner.analyze_people_async(bob, john);
+    auto second = aligner.analyze_people_async(bob, alice);
+    auto third = aligner.analyze_people_async(john, alice);
+
+    REQUIRE(first.get().size() == 23);
+    REQUIRE(second.get().size() == 23);
+    REQUIRE(third.get().size() == 23);
+}
+
+// Completes every alignment straight away, recording the submission order. The result's
+// similarity score holds the size of the helix it was given.
+template<HelixStream T>
+class recording_forker : public AlignmentForker<T> {
+public:
+    using completion = typename AlignmentForker<T>::completion;
+    using AlignmentForker<T>::spawn_alignment;
+
+    std::vector<long> submitted;
+
+    void spawn_alignment(T&& a, T&& b, completion on_done) override {
+        submitted.push_back(a.size());
+        alignment_result res;
+        res.similarity_score = a.size();
+        on_done(std::move(res));
+    }
+};
+
+TEST_CASE("Largest first policy orders chromosomes by descending size") {
+    std::vector<long> sizes { 5, 9, 1, 9, 7 };
+
+    REQUIRE(index_order_policy().order(sizes) == std::vector<std::size_t> { 0, 1, 2, 3, 4 });
+    REQUIRE(largest_first_policy().order(sizes) == std::vector<std::size_t> { 1, 3, 4, 0, 2 });
+}
+
+TEST_CASE("Given realistic chromosome sizes, the largest are submitted first and results keep chromosome order") {
+    fake_person bob = std::move(fake_person_factory::new_person_with_realistic_chromos(2));
+    fake_person john = std::move(fake_person_factory::new_person_with_realistic_chromos(2));
+
+    recording_forker<fake_stream> forker;
+    pairwise_aligner<fake_stream> aligner(forker);
+    auto results = aligner.analyze_people_async(bob, john).get();
+
+    REQUIRE(results.size() == 23);
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        UNSCOPED_INFO("Chromosome " << i);
+        REQUIRE(results[i].similarity_score == bob.chromosome(i).size());
+    }
+
+    REQUIRE(forker.submitted.size() == 23);
+    REQUIRE(std::is_sorted(forker.submitted.rbegin(), forker.submitted.rend()));
+    REQUIRE(forker.submitted.front() == bob.chromosome(0).size());
+}
+
+TEST_CASE("Given a custom scheduling policy, chromosomes are submitted in its order") {
+    fake_person bob = std::move(fake_person_factory::new_person_with_realistic_chromos(2));
+    fake_person john = std::move(fake_person_factory::new_person_with_realistic_chromos(2));
+
+    recording_forker<fake_stream> forker;
+    pairwise_aligner<fake_stream> aligner(forker, index_order_policy::instance());
+    auto results = aligner.analyze_people_async(bob, john).get();
+
+    REQUIRE(results.size() == 23);
+    for (size_t i = 0; i < forker.submitted.size(); ++i)
+        REQUIRE(forker.submitted[i] == bob.chromosome(i).size());
+}
@@ -0,0 +1,176 @@
+#include "catch.hpp"
+#include "fake_person.hpp"
+#include "fogsaa.hpp"
+#include "test_sequences.hpp"
+#include <region_aligner.hpp>
+
+using namespace dna;
+
+static std::string telomere(std::size_t repeats)
+{
+    std::string bases;
+    for (std::size_t i = 0; i < repeats; ++i)
+        bases += "CCCTAA";
+    return bases;
+}
+
+// Every chromosome is the same random body (starting with a base that ends the telomere).
+static std::string body()
+{
+    return "G" + random_bases(9999, 7);
+}
+
+static fake_person person(const std::string& chromosome)
+{
+    std::array<std::string, 23> chromos;
+    chromos.fill(chromosome);
+    return fake_person(chromos, 256);
+}
+
+TEST_CASE("Reading a range of a stream returns just those bases")
+{
+    std::string bases = random_bases(5000, 1);
+    fake_stream stream(bases, 64);
+
+    for (int64_t from : { 0, 1, 2, 3, 255, 1001, 4990 })
+    {
+        INFO("from " << from);
+        REQUIRE(unpack(read_packed(stream, from, 300)) == bases.substr(from, 300));
+    }
+    REQUIRE(read_packed(stream, 4000, 5000).size() == 1000);
+    REQUIRE(read_packed(stream, 6000, 10).size() == 0);
+}
+
+TEST_CASE("Given a region, each person is compared from the end of their own telomere")
+{
+    std::string snp = body();
+    snp[5000] = snp[5000] == 'A' ? 'C' : 'A';
+
+    std::string indel = body();
+    indel[5010] = indel[5010] == 'A' ? 'C' : 'A';
+    indel.insert(4000, "TTT");
+
+    fake_person reference = person(telomere(100) + body());
+    std::vector<fake_person> others;
+    others.push_back(person(telomere(100) + body()));
+    others.push_back(person(telomere(150) + snp));
+    others.push_back(person(telomere(80) + indel));
+    others.push_back(person(body()));
+    others.push_back(person(telomere(100) + body().substr(0, 3000)));
+
+    fogsaa_aligner<packed_stream> fogsaa;
+    thread_pool pool(2);
+    for (thread_pool* p : { static_cast<thread_pool*>(nullptr), &pool })
+    {
+        region_aligner aligner(fogsaa, p, 256);
+        auto results = aligner.compare(reference, 3, location{4900, 200}, others);
+
+        REQUIRE(results.size() == others.size());
+
+        REQUIRE(results[0].error.empty());
+        REQUIRE(results[0].mutations.size() == 0);
+        REQUIRE(results[0].similarity_score == 1);
+
+        REQUIRE(results[1].error.empty());
+        REQUIRE(results[1].mutations.size() == 1);
+        REQUIRE(results[1].mutations[0] == mutation(location{5000, 1}, location{5000, 1}));
+        REQUIRE(results[1].similarity_score == 1 - 1.0 / 200);
+
+        // the insertion before the region only shifts it
+        REQUIRE(results[2].error.empty());
+        REQUIRE(results[2].mutations.size() == 1);
+        REQUIRE(results[2].mutations[0] == mutation(location{5010, 1}, location{5013, 1}));
+
+        REQUIRE(results[3].error == TelomereAnchorErr);
+        REQUIRE(results[4].error == RegionOutOfRangeErr);
+    }
+}
+
+TEST_CASE("Given mutations just outside a region, they are left out")
+{
+    std::string edges = body();
+    edges[4899] = edges[4899] == 'A' ? 'C' : 'A';
+    edges[5100] = edges[5100] == 'A' ? 'C' : 'A';
+
+    fake_person reference = person(telomere(100) + body());
+    std::vector<fake_person> others;
+    others.push_back(person(telomere(100) + edges));
+
+    fogsaa_aligner<packed_stream> fogsaa;
+    region_aligner aligner(fogsaa, nullptr, 256);
+    auto results = aligner.compare(reference, 3, location{4900, 200}, others);
+
+    REQUIRE(results[0].error.empty());
+    REQUIRE(results[0].mutations.size() == 0);
+    REQUIRE(results[0].similarity_score == 1);
+}
+
+TEST_CASE("Given comparisons running on the pool that compares their people, none of them deadlock")
+{
+    std::string snp = body();
+    snp[5000] = snp[5000] == 'A' ? 'C' : 'A';
+
+    fake_person reference = person(telomere(100) + body());
+    std::vector<fake_person> others;
+    for (int i = 0; i < 4; ++i)
+        others.push_back(person(telomere(100) + snp));
+
+    fogsaa_aligner<packed_stream> fogsaa;
+    thread_pool pool(2);
+    region_aligner aligner(fogsaa, &pool, 256);
+
+    std::vector<std::future<std::vector<alignment_result>>> comparisons;
+    for (int i = 0; i < 6; ++i)
+        comparisons.push_back(pool.enqueue([&] { return aligner.compare(reference, 3, location{4900, 200}, others); }));
+
+    for (auto& f : comparisons)
+        for (auto& res : f.get())
+            REQUIRE(res.mutations == std::vector<mutation>{ mutation(location{5000, 1}, location{5000, 1}) });
+}
+
+TEST_CASE("Given k-mer indexes, a region is found past indels longer than the margin")
+{
+    std::string shifted = body();
+    shifted.insert(2000, random_bases(600, 8));
+    shifted[5700] = shifted[5700] == 'A' ? 'C' : 'A';
+    std::string chromosome = telomere(100) + shifted;
+
+    fake_person reference = person(telomere(100) + body());
+    std::vector<fake_person> others;
+    others.push_back(person(chromosome));
+    others.push_back(person(chromosome));
+
+    fake_stream stream(chromosome, 256);
+    std::vector<std::shared_ptr<const kmer_index>> indexes;
+    indexes.push_back(std::make_shared<const kmer_index>(read_packed(stream).view(), 24, 8));
+
+    fogsaa_aligner<packed_stream> fogsaa;
+    region_aligner aligner(fogsaa, nullptr, 64);
+    auto results = aligner.compare(reference, 0, location{5000, 200}, others, indexes);
+
+    REQUIRE(results[0].error.empty());
+    REQUIRE(results[0].mutations.size() == 1);
+    REQUIRE(results[0].mutations[0] == mutation(location{5100, 1}, location{5700, 1}));
+
+    // without an index the region is looked for 600 bases too early
+    REQUIRE(results[1].mutations.size() > 1);
+
+    fake_stream other_stream(telomere(100) + body(), 256);
+    indexes[0] = std::make_shared<const kmer_index>(read_packed(other_stream).view(), 24, 8);
+    results = aligner.compare(reference, 0, location{5000, 200}, others, indexes);
+    REQUIRE(results[0].error == KmerIndexMismatchErr);
+}
+
+TEST_CASE("Given a region the reference does not have, comparing throws")
+{
+    fake_person reference = person(telomere(100) + body());
+    fake_person no_telomere = person(body());
+    std::vector<fake_person> others;
+
+    fogsaa_aligner<packed_stream> fogsaa;
+    region_aligner aligner(fogsaa);
+
+    REQUIRE_THROWS_AS(aligner.compare(reference, 0, location{9990, 100}, others), std::invalid_argument);
+    REQUIRE_THROWS_AS(aligner.compare(no_telomere, 0, location{10, 100}, others), std::invalid_argument);
+    REQUIRE(aligner.compare(reference, 0, location{10, 100}, others).empty());
+}
@@ -0,0 +1,80 @@
+#include "catch.hpp"
+#include "fake_stream.hpp"
+#include "test_sequences.hpp"
+#include <packed_stream.hpp>
+#include <region_search.hpp>
+
+using namespace dna;
+
+// Every match end, by the full edit distance matrix.
+static std::vector<approximate_match> naive_search(const std::string& query, const std::string& text, int64_t max_edits)
+{
+    std::vector<int64_t> column(query.size() + 1);
+    for (std::size_t i = 0; i <= query.size(); ++i)
+        column[i] = i;
+
+    std::vector<approximate_match> matches;
+    for (std::size_t j = 0; j < text.size(); ++j)
+    {
+        int64_t diagonal = 0; // the top row is free
+        for (std::size_t i = 1; i <= query.size(); ++i)
+        {
+            int64_t up = column[i];
+            column[i] = std::min({ diagonal + (query[i - 1] != text[j]), up + 1, column[i - 1] + 1 });
+            diagonal = up;
+        }
+        if (column.back() <= max_edits)
+            matches.push_back(approximate_match{static_cast<int64_t>(j + 1), column.back()});
+    }
+    return matches;
+}
+
+TEST_CASE("Given queries of any length, region search finds the same matches as the full matrix")
+{
+    for (std::size_t qlen : { 1, 20, 64, 65, 130, 200 })
+    {
+        std::string text = random_bases(3000, static_cast<unsigned>(qlen));
+        std::string query = mutate(text.substr(1000, qlen), static_cast<int>(qlen / 20), 5, 1);
+        text.replace(2400, 0, mutate(query, 2, 6, 1));
+
+        auto seq = pack_string(query);
+        for (int64_t k : { 0L, 3L, 12L, 70L })
+        {
+            fake_stream helix(text, 100);
+            region_search search(seq.view(), k);
+            REQUIRE(search.scan(helix) == naive_search(query, text, k));
+        }
+    }
+}
+
+TEST_CASE("Given a region with a few edits, region search finds where it sits")
+{
+    std::string text = random_bases(20000, 7);
+    std::string region = mutate(text.substr(12345, 300), 6, 8, 1);
+    auto query = pack_string(region);
+    auto helix = std::make_shared<const packed_sequence>(pack_string(text));
+
+    packed_stream stream(helix, 0, helix->size());
+    region_search search(query.view(), 10);
+    auto matches = search.scan(stream);
+
+    REQUIRE(!matches.empty());
+    auto best = *std::min_element(matches.begin(), matches.end(),
+            [](auto& a, auto& b) { return a.distance < b.distance; });
+    REQUIRE(best.distance <= 6);
+    REQUIRE(std::abs(best.end - (12345 + 300)) <= 6);
+    for (auto& m : matches)
+        REQUIRE(std::abs(m.end - (12345 + 300)) <= 20);
+}
+
+TEST_CASE("Rescanning a helix gives the same matches")
+{
+    std::string text = random_bases(5000, 9);
+    auto query = pack_string(text.substr(4000, 100));
+    fake_stream helix(text, 64);
+
+    region_search search(query.view(), 5);
+    auto first = search.scan(helix);
+    REQUIRE(first.size() > 0);
+    REQUIRE(search.scan(helix) == first);
+}
@@ -0,0 +1,80 @@
+#include "catch.hpp"
+#include "fake_person_factory.hpp"
+#include "fogsaa.hpp"
+#include <pairwise_aligner.hpp>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+using namespace dna;
+
+// Hidden by default, run with: dna_test "[benchmark]"
+
+// Runs every chromosome of the comparison as its own pool task.
+class pooled_forker : public AlignmentForker<fake_stream> {
+    thread_pool& pool_;
+    fogsaa_aligner<fake_stream> aligner_;
+
+public:
+    explicit pooled_forker(thread_pool& pool) : pool_(pool) {}
+
+    using AlignmentForker<fake_stream>::spawn_alignment;
+
+    void spawn_alignment(fake_stream&& a, fake_stream&& b, completion on_done) override {
+        auto pair = std::make_shared<std::pair<fake_stream, fake_stream>>(std::move(a), std::move(b));
+        pool_.enqueue([this, pair, on_done]
+                {
+                    on_done(aligner_.align(pair->first, pair->second));
+                });
+    }
+};
+
+// Makespan of greedily assigning jobs, in order, to the least loaded of `workers` workers.
+static long modelled_makespan(const std::vector<long>& sizes, const std::vector<std::size_t>& order,
+        std::size_t workers)
+{
+    std::vector<long> load(workers, 0);
+    for (std::size_t i : order)
+        *std::min_element(load.begin(), load.end()) += sizes[i];
+    return *std::max_element(load.begin(), load.end());
+}
+
+static double seconds_to_compare(fake_person& p1, fake_person& p2, std::size_t workers,
+        const scheduling_policy& schedule)
+{
+    thread_pool pool(workers);
+    pooled_forker forker(pool);
+    pairwise_aligner<fake_stream> aligner(forker, schedule);
+
+    auto start = std::chrono::steady_clock::now();
+    auto results = aligner.analyze_people_async(p1, p2).get();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    REQUIRE(results.size() == 23);
+    return elapsed.count();
+}
+
+TEST_CASE("Chromosome scheduling makespan", "[.][benchmark]")
+{
+    fake_person bob = fake_person_factory::new_person_with_realistic_chromos(64);
+    fake_person john = fake_person_factory::new_person_with_realistic_chromos(64);
+
+    std::vector<long> sizes;
+    for (std::size_t i = 0; i < bob.chromosomes(); ++i)
+        sizes.push_back(bob.chromosome(i).size());
+
+    for (std::size_t workers : { 4, 8 })
+    {
+        std::cout << workers << " workers, modelled makespan (bases): index order "
+                  << modelled_makespan(sizes, index_order_policy::instance().order(sizes), workers)
+                  << ", largest first "
+                  << modelled_makespan(sizes, largest_first_policy::instance().order(sizes), workers)
+                  << std::endl;
+
+        double by_index = seconds_to_compare(bob, john, workers, index_order_policy::instance());
+        double largest_first = seconds_to_compare(bob, john, workers, largest_first_policy::instance());
+        std::cout << workers << " workers, measured: index order " << by_index
+                  << "s, largest first " << largest_first << "s" << std::endl;
+    }
+}
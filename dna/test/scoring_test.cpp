@@ -0,0 +1,39 @@
+#include "catch.hpp"
+#include <scoring.hpp>
+
+using namespace dna;
+
+TEST_CASE("Given a transition table, transitions and transversions score apart")
+{
+    using scoring = transition_scoring<2, -1, -3, -4, -1>;
+
+    REQUIRE(scoring::substitution(A, A) == 2);
+    REQUIRE(scoring::substitution(A, G) == -1);
+    REQUIRE(scoring::substitution(T, C) == -1);
+    REQUIRE(scoring::substitution(A, T) == -3);
+    REQUIRE(scoring::substitution(G, C) == -3);
+    REQUIRE(scoring::gap_open() == -4);
+    REQUIRE(scoring::gap_extend() == -1);
+
+    static_assert(best_substitution(scoring()) == 2);
+    static_assert(worst_substitution(scoring()) == -3);
+    static_assert(!uniform_substitutions(scoring()));
+    static_assert(uniform_substitutions(fogsaa_scoring()));
+}
+
+TEST_CASE("Given a compile time policy, runtime scoring gives the same scores")
+{
+    using scoring = transition_scoring<2, -1, -3, -4, -1>;
+    runtime_scoring runtime{scoring()};
+
+    for (base a : { A, C, G, T })
+        for (base b : { A, C, G, T })
+            REQUIRE(runtime.substitution(a, b) == scoring::substitution(a, b));
+    REQUIRE(runtime.gap_open() == -4);
+    REQUIRE(runtime.gap_extend() == -1);
+
+    runtime_scoring linear(1, -1, 0, -2);
+    REQUIRE(linear.substitution(C, C) == 1);
+    REQUIRE(linear.substitution(C, G) == -1);
+    REQUIRE(uniform_substitutions(linear));
+}
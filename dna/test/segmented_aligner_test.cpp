@@ -0,0 +1,146 @@
+#include "catch.hpp"
+#include "fogsaa.hpp"
+#include "fake_stream.hpp"
+#include "test_sequences.hpp"
+#include <segmented_aligner.hpp>
+
+using namespace dna;
+
+TEST_CASE("Packed streams read any range of a packed sequence")
+{
+    std::string bases = random_bases(1000, 1);
+    auto seq = std::make_shared<const packed_sequence>(pack_string(bases));
+
+    packed_stream stream(seq, 7, 500, 64);
+    REQUIRE(stream.size() == 500);
+
+    std::string read;
+    for (auto buf = stream.read(); buf.size() > 0; buf = stream.read())
+        for (auto b : buf)
+            read += to_char(b);
+    REQUIRE(read == bases.substr(7, 500));
+
+    stream.seek(497);
+    auto end = stream.read();
+    REQUIRE(end.size() == 3);
+    REQUIRE(to_char(end[0]) == bases[504]);
+}
+
+TEST_CASE("Packed streams lend ranges that start on a byte")
+{
+    std::string bases = random_bases(1000, 1);
+    auto seq = std::make_shared<const packed_sequence>(pack_string(bases));
+
+    packed_stream aligned(seq, 8, 500);
+    helix_bases lent = read_helix(aligned);
+    REQUIRE(lent.size() == 500);
+    REQUIRE(lent.view().buffer().data() == seq->bytes().data() + 2);
+
+    packed_stream unaligned(seq, 7, 500);
+    REQUIRE(unaligned.whole_view().size() == 0);
+    helix_bases copied = read_helix(unaligned);
+    REQUIRE(copied.size() == 500);
+    REQUIRE(copied.view()[0] == (*seq)[7]);
+    REQUIRE(copied.view()[499] == (*seq)[506]);
+
+    // streams over the bases read the same as over the sequence
+    packed_stream range(lent, 3, 10);
+    auto buf = range.read();
+    REQUIRE(buf.size() == 10);
+    REQUIRE(buf[0] == (*seq)[11]);
+}
+
+TEST_CASE("Anchors are chained in order on both helixes")
+{
+    std::string bases = random_bases(20000, 2);
+    std::string shifted = bases.substr(0, 5000) + "ACGTAC" + bases.substr(5000);
+
+    auto chain = anchor_finder::chain(anchor_finder(256).find(pack_string(bases).view(), pack_string(shifted).view()));
+    REQUIRE(chain.size() > 10);
+    for (std::size_t i = 0; i < chain.size(); ++i)
+    {
+        REQUIRE(chain[i].helix2 - chain[i].helix1 == (chain[i].helix1 < 5000 ? 0 : 6));
+        if (i > 0)
+            REQUIRE(chain[i].helix1 > chain[i - 1].helix1);
+    }
+}
+
+TEST_CASE("Given a long pair of strands, it should be split into segments covering both")
+{
+    std::string bases = random_bases(20000, 3);
+    auto segments = anchor_finder(256).plan(pack_string(bases).view(), pack_string(bases).view(), 1000);
+
+    REQUIRE(segments.size() > 1);
+    int64_t end1 = 0, end2 = 0;
+    for (auto& seg : segments)
+    {
+        REQUIRE(seg.helix1.offset == end1);
+        REQUIRE(seg.helix2.offset == end2);
+        REQUIRE(seg.helix1.length >= 1000);
+        end1 += seg.helix1.length;
+        end2 += seg.helix2.length;
+    }
+    REQUIRE(end1 == 20000);
+    REQUIRE(end2 == 20000);
+}
+
+TEST_CASE("Given mutations in several segments, segmented alignment finds all of them")
+{
+    std::string bases = random_bases(20000, 4);
+    std::string mutated = bases;
+    mutated[1500] = mutated[1500] == 'A' ? 'C' : 'A';
+    mutated[9000] = mutated[9000] == 'G' ? 'T' : 'G';
+    mutated[17000] = mutated[17000] == 'G' ? 'T' : 'G';
+
+    fake_stream s1(bases, 512), s2(mutated, 512);
+    fogsaa_aligner<packed_stream> fogsaa;
+    thread_pool pool(4);
+    segmented_aligner<fake_stream> aligner(fogsaa, &pool, 1000, 256);
+    alignment_result res = aligner.align(s1, s2);
+
+    REQUIRE(res.error.empty());
+    REQUIRE(res.mutations.size() == 3);
+    REQUIRE(res.mutations[0] == mutation(location{1500,1}, location{1500,1}));
+    REQUIRE(res.mutations[1] == mutation(location{9000,1}, location{9000,1}));
+    REQUIRE(res.mutations[2] == mutation(location{17000,1}, location{17000,1}));
+    REQUIRE(res.similarity_score == 1 - 3.0 / 20000);
+}
+
+TEST_CASE("Given alignments running on the pool that aligns their segments, none of them deadlock")
+{
+    std::string bases = random_bases(20000, 5);
+    std::string mutated = bases;
+    mutated[7000] = mutated[7000] == 'A' ? 'C' : 'A';
+
+    fogsaa_aligner<packed_stream> fogsaa;
+    thread_pool pool(2);
+    segmented_aligner<fake_stream> aligner(fogsaa, &pool, 1000, 256);
+
+    std::vector<std::future<alignment_result>> results;
+    for (int i = 0; i < 8; ++i)
+        results.push_back(pool.enqueue([&]
+                {
+                    fake_stream s1(bases, 512), s2(mutated, 512);
+                    return aligner.align(s1, s2);
+                }));
+
+    for (auto& f : results)
+    {
+        alignment_result res = f.get();
+        REQUIRE(res.mutations.size() == 1);
+        REQUIRE(res.mutations[0] == mutation(location{7000,1}, location{7000,1}));
+    }
+}
+
+TEST_CASE("Given strands without shared anchors, segmented alignment aligns them whole")
+{
+    fake_stream s1("ACGGTTGC", 512);
+    fake_stream s2("AGCGTC", 512);
+
+    fogsaa_aligner<packed_stream> fogsaa;
+    segmented_aligner<fake_stream> aligner(fogsaa);
+    alignment_result res = aligner.align(s1, s2);
+
+    REQUIRE(res.mutations.size() == 3);
+    REQUIRE(res.similarity_score == 0.5);
+}
@@ -44,3 +44,85 @@ TEST_CASE("Can use an iterator", "[seqbuf]")
 	REQUIRE(bases[7] == dna::C);
 
 }
+
+TEST_CASE("Can read packed words at any base offset", "[seqbuf]")
+{
+	std::array<std::byte, 3> data = {
+			dna::pack(dna::G, dna::A, dna::C, dna::T),
+			dna::pack(dna::A, dna::A, dna::G, dna::C),
+			dna::pack(dna::T, dna::T, dna::T, dna::T),
+	};
+
+	dna::sequence_buffer buf(data, 10);
+	REQUIRE(buf.word_at(0) == 0x8709f00000000000ULL);
+	REQUIRE(buf.word_at(1) == 0x1c27c00000000000ULL);
+	REQUIRE(buf.word_at(9) == 0xc000000000000000ULL);
+	REQUIRE(buf.word_at(10) == 0);
+}
+
+TEST_CASE("Can find mismatches between sequence buffers", "[seqbuf]")
+{
+	std::vector<std::byte> data1(300);
+	for (std::size_t i = 0; i < data1.size(); ++i)
+		data1[i] = static_cast<std::byte>(i * 37);
+	auto data2 = data1;
+	data2[0] ^= std::byte{0x10};   // base 1
+	data2[130] ^= std::byte{0x03}; // base 523
+	data2[131] ^= std::byte{0xc0}; // base 524
+
+	dna::sequence_buffer<std::vector<std::byte>> buf1(data1);
+	dna::sequence_buffer<std::vector<std::byte>> buf2(data2);
+
+	REQUIRE(buf1.mismatch(buf2) == 1);
+	REQUIRE(buf1.mismatch(buf2, 2) == 523);
+	REQUIRE(buf1.mismatches(buf2) == std::vector<std::size_t>{1, 523, 524});
+	REQUIRE(buf1.count_mismatches(buf2) == 3);
+
+	std::vector<std::size_t> expected;
+	for (std::size_t i = 0; i < buf1.size(); ++i)
+		if (buf1[i] != buf2[i])
+			expected.push_back(i);
+	REQUIRE(buf1.mismatches(buf2) == expected);
+}
+
+TEST_CASE("Can find mismatches at every phase of a byte after a restart", "[seqbuf]")
+{
+	std::vector<std::byte> data1(4096);
+	for (std::size_t i = 0; i < data1.size(); ++i)
+		data1[i] = static_cast<std::byte>(i * 37);
+	auto data2 = data1;
+	for (std::size_t i = 0; i < 40; ++i)
+		data2[i * 97 + 3] ^= std::byte{0x03} << ((i % 4) * 2);
+
+	dna::sequence_buffer<std::vector<std::byte>> buf1(data1);
+	dna::sequence_buffer<std::vector<std::byte>> buf2(data2);
+
+	std::vector<std::size_t> expected;
+	for (std::size_t i = 0; i < buf1.size(); ++i)
+		if (buf1[i] != buf2[i])
+			expected.push_back(i);
+	REQUIRE(expected.size() == 40);
+	REQUIRE(buf1.mismatches(buf2) == expected);
+	REQUIRE(buf1.count_mismatches(buf2) == 40);
+	for (std::size_t i = 1; i < expected.size(); ++i)
+		REQUIRE(buf1.mismatch(buf2, expected[i - 1] + 1) == expected[i]);
+}
+
+TEST_CASE("Mismatches only cover the bases both sequence buffers hold", "[seqbuf]")
+{
+	std::array<std::byte, 2> data1 = {
+			dna::pack(dna::G, dna::A, dna::C, dna::T),
+			dna::pack(dna::A, dna::A, dna::G, dna::C),
+	};
+	std::array<std::byte, 2> data2 = {
+			dna::pack(dna::G, dna::A, dna::C, dna::T),
+			dna::pack(dna::A, dna::T, dna::T, dna::T),
+	};
+
+	dna::sequence_buffer buf1(data1);
+	dna::sequence_buffer buf2(data2, 5);
+
+	REQUIRE(buf1.mismatch(buf2) == 5);
+	REQUIRE(buf1.mismatches(buf2).empty());
+	REQUIRE(buf1.count_mismatches(buf2) == 0);
+}
@@ -0,0 +1,103 @@
+#include "catch.hpp"
+#include "fake_stream.hpp"
+#include "test_sequences.hpp"
+#include <smith_waterman.hpp>
+
+using namespace dna;
+
+// Best local (or, if global, whole) alignment score by the full Gotoh matrix. For local
+// alignments end is set to the first target base, then query base, the best score ends on.
+template<ScoringPolicy S>
+static int64_t gotoh(const std::string& query, const std::string& target, const S& sc, bool global,
+        std::pair<int64_t, int64_t>* end = nullptr)
+{
+    const int64_t inf = 1LL << 40;
+    const std::size_t n = query.size(), m = target.size();
+    std::vector<std::vector<int64_t>> h(n + 1, std::vector<int64_t>(m + 1, global ? -inf : 0));
+    auto e = std::vector<std::vector<int64_t>>(n + 1, std::vector<int64_t>(m + 1, -inf)), f = e;
+    h[0][0] = 0;
+    int64_t best = 0;
+    for (std::size_t t = 0; t <= m; ++t)
+        for (std::size_t q = 0; q <= n; ++q)
+        {
+            if (q == 0 && t == 0)
+                continue;
+            if (t > 0)
+                e[q][t] = std::max(e[q][t - 1] + sc.gap_extend(), h[q][t - 1] + sc.gap_open() + sc.gap_extend());
+            if (q > 0)
+                f[q][t] = std::max(f[q - 1][t] + sc.gap_extend(), h[q - 1][t] + sc.gap_open() + sc.gap_extend());
+            int64_t cell = std::max(e[q][t], f[q][t]);
+            if (q > 0 && t > 0)
+                cell = std::max(cell, h[q - 1][t - 1] + sc.substitution(from_char(query[q - 1]), from_char(target[t - 1])));
+            h[q][t] = global ? cell : std::max<int64_t>(cell, 0);
+            if (!global && h[q][t] > best && q > 0 && t > 0)
+            {
+                best = h[q][t];
+                if (end != nullptr)
+                    *end = { static_cast<int64_t>(q - 1), static_cast<int64_t>(t - 1) };
+            }
+        }
+    return global ? h[n][m] : best;
+}
+
+template<ScoringPolicy S>
+static void require_best(const std::string& query, const std::string& target, const S& sc)
+{
+    auto q = pack_string(query), t = pack_string(target);
+    local_alignment res = striped_smith_waterman<S>(q.view(), sc).align(t.view());
+
+    std::pair<int64_t, int64_t> end;
+    REQUIRE(res.score == gotoh(query, target, sc, false, &end));
+    REQUIRE(res.query.offset + res.query.length - 1 == end.first);
+    REQUIRE(res.target.offset + res.target.length - 1 == end.second);
+
+    // The reported parts align end to end with the best score.
+    REQUIRE(gotoh(query.substr(res.query.offset, res.query.length),
+                target.substr(res.target.offset, res.target.length), sc, true) == res.score);
+}
+
+TEST_CASE("Given any query and target, the striped kernel finds the best local alignment")
+{
+    for (unsigned seed = 0; seed < 20; ++seed)
+    {
+        std::string target = random_bases(300, seed);
+        std::string query = mutate(target.substr(seed * 7, 40 + seed * 5), 6, seed + 50);
+        require_best(query, target, fogsaa_scoring());
+        require_best(query, target, affine_scoring<2, -3, -4, -1>());
+        require_best(query, target, transition_scoring<2, -1, -3, -3, -1>());
+        require_best(query, target, runtime_scoring(3, -2, -2, -2));
+    }
+}
+
+TEST_CASE("Given scores that overflow the narrow lanes, the striped kernel aligns again in wider ones")
+{
+    std::string target = random_bases(800, 3);
+    std::string query = mutate(target.substr(100, 600), 5, 4);
+
+    require_best(query, target, fogsaa_scoring()); // over 255, 16 bit lanes
+    require_best(query, target, affine_scoring<100, -50, -60, -60>()); // over 32767, no lanes
+}
+
+TEST_CASE("Given a region of another strand, Smith-Waterman finds it in a candidate window")
+{
+    std::string window = random_bases(100000, 5);
+    std::string region = mutate(window.substr(61000, 10000), 20, 6);
+    auto query = pack_string(region);
+    fake_stream helix(window, 4096);
+
+    local_alignment res = striped_smith_waterman(query.view()).align(helix);
+    REQUIRE(res.score > 9000);
+    REQUIRE(std::abs(res.target.offset - 61000) < 50);
+    REQUIRE(std::abs(res.target.offset + res.target.length - 71000) < 50);
+    REQUIRE(res.query.length > 9900);
+}
+
+TEST_CASE("Given strands with nothing in common, Smith-Waterman aligns nothing")
+{
+    auto query = pack_string("AAAAAAAA"), target = pack_string("CCCCCCCCCCCC");
+    local_alignment res = striped_smith_waterman(query.view()).align(target.view());
+
+    REQUIRE(res.score == 0);
+    REQUIRE(res.query.length == 0);
+    REQUIRE(res.target.length == 0);
+}
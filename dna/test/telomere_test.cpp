@@ -0,0 +1,108 @@
+#include "catch.hpp"
+#include "fake_stream.hpp"
+#include "test_sequences.hpp"
+#include <packed_stream.hpp>
+#include <telomere.hpp>
+
+using namespace dna;
+
+static std::string repeat(const std::string& motif, std::size_t count)
+{
+    std::string bases;
+    for (std::size_t i = 0; i < count; ++i)
+        bases += motif;
+    return bases;
+}
+
+TEST_CASE("Telomere repeats are found at the start of a helix at any phase")
+{
+    std::string body = "C" + random_bases(1000, 1);
+
+    for (std::size_t phase = 0; phase < 6; ++phase)
+    {
+        for (std::size_t repeats : { 3, 50, 1700 })
+        {
+            std::string telomere = repeat("TTAGGG", repeats).substr(phase);
+            INFO("phase " << phase << " repeats " << repeats);
+            REQUIRE(telomere_prefix(pack_string(telomere + body).view()) == static_cast<int64_t>(telomere.size()));
+        }
+    }
+
+    REQUIRE(telomere_prefix(pack_string(repeat("CCCTAA", 100) + "G" + body).view()) == 600);
+}
+
+TEST_CASE("Telomere repeats are found at the end of a helix at any phase")
+{
+    std::string body = random_bases(1001, 2) + "C";
+
+    for (std::size_t phase = 0; phase < 6; ++phase)
+    {
+        for (std::size_t repeats : { 3, 50, 1700 })
+        {
+            std::string telomere = repeat("TTAGGG", repeats);
+            telomere.resize(telomere.size() - phase);
+            INFO("phase " << phase << " repeats " << repeats);
+            REQUIRE(telomere_suffix(pack_string(body + telomere).view()) == static_cast<int64_t>(telomere.size()));
+        }
+    }
+}
+
+TEST_CASE("Short or missing repeats are not telomeres")
+{
+    std::string body = random_bases(1000, 3);
+
+    REQUIRE(telomere_prefix(pack_string(body).view()) == 0);
+    REQUIRE(telomere_suffix(pack_string(body).view()) == 0);
+    REQUIRE(telomere_prefix(pack_string("TTAGGGTTAGGC" + body).view()) == 0);
+    REQUIRE(telomere_suffix(pack_string(body + "CTAGGGTTAGGG").view()) == 0);
+}
+
+TEST_CASE("A damaged repeat ends the telomere")
+{
+    std::string telomere = repeat("TTAGGG", 1000);
+    telomere[3001] = 'C';
+
+    REQUIRE(telomere_prefix(pack_string(telomere + random_bases(100, 4)).view()) == 3001);
+    REQUIRE(telomere_suffix(pack_string(random_bases(100, 4) + telomere).view()) == 6000 - 3002);
+}
+
+TEST_CASE("Trimming a loaded helix keeps the part between its telomeres")
+{
+    std::string body = "A" + random_bases(5000, 5) + "A";
+    auto seq = pack_string(repeat("CCCTAA", 300) + body + repeat("TTAGGG", 400).substr(0, 2399));
+
+    REQUIRE(trim_telomeres(seq) == location{1800, static_cast<int64_t>(body.size())});
+    REQUIRE(trim_telomeres(pack_string(repeat("TTAGGG", 10))) == location{60, 0});
+}
+
+TEST_CASE("Trimming a stream only reads its ends and agrees with trimming it loaded")
+{
+    std::string body = "A" + random_bases(200000, 6) + "A";
+    for (std::size_t front : { 0, 1, 2000, 9000 })
+    {
+        for (std::size_t back : { 0, 3, 2001, 12000 })
+        {
+            std::string bases = repeat("CCCTAA", 2000).substr(12000 - front) + body
+                    + repeat("TTAGGG", 2000).substr(0, back);
+            INFO("front " << front << " back " << back);
+
+            fake_stream stream(bases, 256);
+            location expected = trim_telomeres(pack_string(bases));
+            // a single partial repeat is too short to count
+            int64_t trimmed_front = front < 12 ? 0 : front, trimmed_back = back < 12 ? 0 : back;
+            REQUIRE(expected == location{trimmed_front,
+                    static_cast<int64_t>(bases.size()) - trimmed_front - trimmed_back});
+            REQUIRE(trim_telomeres(stream, 4096) == expected);
+
+            auto seq = std::make_shared<const packed_sequence>(pack_string(bases));
+            packed_stream packed(seq, 0, seq->size(), 1000);
+            REQUIRE(trim_telomeres(packed, 4096) == expected);
+        }
+    }
+}
+
+TEST_CASE("Trimming a stream that is all telomere leaves nothing")
+{
+    fake_stream stream(repeat("TTAGGG", 3000), 64);
+    REQUIRE(trim_telomeres(stream, 1024) == location{18000, 0});
+}
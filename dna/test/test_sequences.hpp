@@ -0,0 +1,60 @@
+#pragma once
+
+#include "fake_stream.hpp"
+#include <packed_sequence.hpp>
+#include <packed_stream.hpp>
+#include <random>
+#include <string>
+
+// Random bases, the same for the same seed.
+inline std::string random_bases(std::size_t count, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::string bases(count, 'A');
+    for (auto& b : bases)
+        b = "ACGT"[gen() % 4];
+    return bases;
+}
+
+// A base other than b.
+inline char other_base(char b)
+{
+    return b == 'A' ? 'C' : 'A';
+}
+
+inline dna::packed_sequence pack_string(const std::string& bases)
+{
+    fake_stream stream(bases, 512);
+    return dna::read_packed(stream);
+}
+
+inline std::string unpack(const dna::packed_sequence& seq)
+{
+    std::string bases;
+    for (std::size_t i = 0; i < seq.size(); ++i)
+        bases += dna::to_char(seq[i]);
+    return bases;
+}
+
+// Applies edits random substitutions, insertions and deletions of up to max_length bases.
+inline std::string mutate(std::string bases, int edits, unsigned seed, std::size_t max_length = 3)
+{
+    std::mt19937 gen(seed);
+    for (int i = 0; i < edits; ++i)
+    {
+        std::size_t at = gen() % bases.size();
+        std::size_t len = 1 + gen() % max_length;
+        switch (gen() % 3)
+        {
+        case 0:
+            bases[at] = other_base(bases[at]);
+            break;
+        case 1:
+            bases.insert(at, random_bases(len, gen()));
+            break;
+        default:
+            bases.erase(at, len);
+        }
+    }
+    return bases;
+}
@@ -0,0 +1,50 @@
+#include "catch.hpp"
+#include <thread_pool.hpp>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+// Hidden by default, run with: dna_test "[benchmark]"
+
+static double tasks_per_second(std::size_t workers, std::size_t tasks)
+{
+    std::atomic<std::size_t> done(0);
+    auto start = std::chrono::steady_clock::now();
+    {
+        thread_pool pool(workers);
+
+        // Half the tasks are submitted from outside the pool, the rest fan out from inside it
+        // (the way segments of a chromosome are spawned by the chromosome task).
+        const std::size_t fan_out = 64;
+        std::vector<std::future<void>> roots;
+        for (std::size_t i = 0; i < tasks / 2 / fan_out; ++i)
+        {
+            roots.push_back(pool.enqueue([&pool, &done, fan_out]
+                    {
+                        for (std::size_t j = 0; j < fan_out; ++j)
+                            pool.enqueue([&done] { ++done; });
+                        ++done;
+                    }));
+        }
+        for (std::size_t i = 0; i < tasks / 2; ++i)
+            pool.enqueue([&done] { ++done; });
+        for (auto& f : roots)
+            f.get();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return done / elapsed.count();
+}
+
+TEST_CASE("Thread pool throughput", "[.][benchmark]")
+{
+    const std::size_t tasks = 1 << 20;
+    for (std::size_t workers : {1, 2, 4, 8, 16, 32, 64})
+    {
+        BENCHMARK("thread_pool " + std::to_string(workers) + " workers")
+        {
+            std::cout << workers << " workers: " << static_cast<std::size_t>(tasks_per_second(workers, tasks))
+                      << " tasks/sec" << std::endl;
+        }
+    }
+}
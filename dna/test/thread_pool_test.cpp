@@ -0,0 +1,85 @@
+#include "catch.hpp"
+#include <thread_pool.hpp>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Thread pool runs every task and returns its result", "[pool]")
+{
+    thread_pool pool(4);
+    std::vector<std::future<int>> futures;
+    for (int i = 0; i < 10000; ++i)
+        futures.push_back(pool.enqueue([](int x) { return x * 2; }, i));
+
+    for (int i = 0; i < 10000; ++i)
+        REQUIRE(futures[i].get() == i * 2);
+}
+
+TEST_CASE("Thread pool tasks can enqueue more tasks", "[pool]")
+{
+    thread_pool pool(4);
+    std::atomic<int> count(0);
+
+    auto outer = pool.enqueue([&pool, &count]
+            {
+                std::vector<std::future<void>> inner;
+                for (int i = 0; i < 1000; ++i)
+                    inner.push_back(pool.enqueue([&count] { ++count; }));
+                return inner;
+            });
+
+    for (auto& f : outer.get())
+        f.get();
+    REQUIRE(count == 1000);
+}
+
+TEST_CASE("Thread pool tasks can wait for tasks they enqueue", "[pool]")
+{
+    thread_pool pool(1);
+    auto outer = pool.enqueue([&pool]
+            {
+                int total = 0;
+                for (int i = 0; i < 100; ++i)
+                {
+                    auto inner = pool.enqueue([i] { return i; });
+                    total += pool.wait(inner);
+                }
+                return total;
+            });
+
+    REQUIRE(pool.wait(outer) == 4950);
+}
+
+TEST_CASE("Thread pool passes exceptions to the future", "[pool]")
+{
+    thread_pool pool(2);
+    auto f = pool.enqueue([]() -> int { throw std::runtime_error("failed"); });
+    REQUIRE_THROWS_AS(f.get(), std::runtime_error);
+}
+
+TEST_CASE("Thread pool finishes queued tasks before it is destroyed", "[pool]")
+{
+    std::atomic<int> count(0);
+    {
+        thread_pool pool(1);
+        for (int i = 0; i < 500; ++i)
+            pool.enqueue([&count] { ++count; });
+    }
+    REQUIRE(count == 500);
+}
+
+TEST_CASE("Thread pool runs tasks its tasks enqueue while it is being destroyed", "[pool]")
+{
+    std::atomic<int> count(0);
+    {
+        thread_pool pool(1);
+        pool.enqueue([&pool, &count]
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                    pool.enqueue([&count] { ++count; });
+                    ++count;
+                });
+    }
+    REQUIRE(count == 2);
+}
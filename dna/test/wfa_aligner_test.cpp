@@ -0,0 +1,185 @@
+#include "catch.hpp"
+#include "fogsaa.hpp"
+#include "fake_stream.hpp"
+#include "test_sequences.hpp"
+#include <wfa_aligner.hpp>
+
+using namespace dna;
+
+static alignment_result wfa_align(const std::string& a, const std::string& b, std::size_t max_cells = 1 << 22)
+{
+    fake_stream s1(a, 512), s2(b, 512);
+    wfa_aligner<fake_stream> aligner(wfa_penalties(), max_cells);
+    return aligner.align(s1, s2);
+}
+
+static alignment_result fogsaa_align(const std::string& a, const std::string& b)
+{
+    fake_stream s1(a, 512), s2(b, 512);
+    return fogsaa::align(s1, s2);
+}
+
+// Total penalty of an alignment.
+static int64_t penalty(const edit_transcript& transcript, const wfa_penalties& pen)
+{
+    int64_t total = 0;
+    for (auto& run : transcript.runs())
+    {
+        if (run.op == edit_op::mismatch)
+            total += run.length * pen.mismatch;
+        else if (run.op != edit_op::match)
+            total += pen.gap_open + run.length * pen.gap_extend;
+    }
+    return total;
+}
+
+// Lowest penalty of any alignment, by the full (Gotoh) matrix.
+static int64_t gotoh_penalty(const std::string& a, const std::string& b, const wfa_penalties& pen)
+{
+    const int64_t inf = 1LL << 40;
+    const std::size_t n1 = a.size(), n2 = b.size();
+    std::vector<std::vector<int64_t>> h(n1 + 1, std::vector<int64_t>(n2 + 1, inf));
+    auto e = h, f = h;
+    h[0][0] = 0;
+    for (std::size_t i = 0; i <= n1; ++i)
+        for (std::size_t j = 0; j <= n2; ++j)
+        {
+            if (j > 0)
+                e[i][j] = std::min(h[i][j - 1] + pen.gap_open + pen.gap_extend, e[i][j - 1] + pen.gap_extend);
+            if (i > 0)
+                f[i][j] = std::min(h[i - 1][j] + pen.gap_open + pen.gap_extend, f[i - 1][j] + pen.gap_extend);
+            if (i > 0 && j > 0)
+                h[i][j] = h[i - 1][j - 1] + (a[i - 1] != b[j - 1] ? pen.mismatch : 0);
+            h[i][j] = std::min({ h[i][j], e[i][j], f[i][j] });
+        }
+    return h[n1][n2];
+}
+
+TEST_CASE("Given identical strands, wavefront alignment finds no mutations")
+{
+    std::string bases = random_bases(10000, 1);
+    alignment_result res = wfa_align(bases, bases);
+
+    REQUIRE(res.error.empty());
+    REQUIRE(res.mutations.size() == 0);
+    REQUIRE(res.similarity_score == 1);
+}
+
+TEST_CASE("Given point mutations, wavefront alignment agrees with FOGSAA")
+{
+    std::string bases = random_bases(8000, 2);
+    std::string mutated = bases;
+    for (std::size_t i : { 0, 700, 701, 2500, 5003, 7999 })
+        mutated[i] = other_base(mutated[i]);
+
+    alignment_result res = wfa_align(bases, mutated);
+    alignment_result expected = fogsaa_align(bases, mutated);
+
+    REQUIRE(res.mutations.size() == 5);
+    REQUIRE(res.mutations[1] == mutation(location{700, 2}, location{700, 2}));
+    REQUIRE(res.mutations == expected.mutations);
+    REQUIRE(res.similarity_score == expected.similarity_score);
+}
+
+TEST_CASE("Given indels, wavefront alignment scores as well as FOGSAA")
+{
+    // Equally good alignments can place a gap differently, so only the penalties are compared.
+    for (unsigned seed = 0; seed < 10; ++seed)
+    {
+        std::string bases = random_bases(400, seed);
+        std::string mutated = mutate(bases, 8, seed + 100);
+        auto s1 = pack_string(bases), s2 = pack_string(mutated);
+
+        int64_t expected = penalty(fogsaa::transcribe(s1.view(), s2.view()), wfa_penalties());
+        REQUIRE(penalty(wavefront_engine().transcribe(s1.view(), s2.view()), wfa_penalties()) == expected);
+        REQUIRE(gotoh_penalty(bases, mutated, wfa_penalties()) == expected);
+    }
+}
+
+TEST_CASE("Given affine gaps, wavefront alignment finds the lowest penalty")
+{
+    wfa_penalties affine{4, 6, 2};
+    for (unsigned seed = 0; seed < 10; ++seed)
+    {
+        std::string bases = random_bases(300, seed + 20);
+        std::string mutated = mutate(bases, 10, seed + 200);
+        auto s1 = pack_string(bases), s2 = pack_string(mutated);
+
+        int64_t expected = gotoh_penalty(bases, mutated, affine);
+        REQUIRE(penalty(wavefront_engine(affine).transcribe(s1.view(), s2.view()), affine) == expected);
+    }
+}
+
+TEST_CASE("Given a scoring policy, wavefront alignment ranks alignments by its scores")
+{
+    wfa_penalties fogsaa = to_penalties(fogsaa_scoring());
+    REQUIRE(fogsaa.mismatch == 4);
+    REQUIRE(fogsaa.gap_open == 0);
+    REQUIRE(fogsaa.gap_extend == 5);
+
+    wfa_penalties affine = to_penalties(affine_scoring<0, -2, -3, -1>());
+    REQUIRE(affine.mismatch == 4);
+    REQUIRE(affine.gap_open == 6);
+    REQUIRE(affine.gap_extend == 2);
+
+    using matrix = transition_scoring<1, -1, -2, 0, -2>;
+    REQUIRE_THROWS_AS(to_penalties(matrix()), std::invalid_argument);
+}
+
+TEST_CASE("Given too little memory for a traceback, wavefront alignment splits without losing the best alignment")
+{
+    for (auto pen : { wfa_penalties(), wfa_penalties{4, 6, 2} })
+        for (unsigned seed = 0; seed < 10; ++seed)
+        {
+            std::string bases = random_bases(500, seed + 40);
+            std::string mutated = mutate(bases, 15, seed + 300);
+            auto s1 = pack_string(bases), s2 = pack_string(mutated);
+
+            edit_transcript split = wavefront_engine(pen, 64).transcribe(s1.view(), s2.view());
+            REQUIRE(penalty(split, pen) == gotoh_penalty(bases, mutated, pen));
+
+            // The transcript still spells out the two strands.
+            int64_t len1 = 0, len2 = 0;
+            for (auto& run : split.runs())
+            {
+                len1 += run.op == edit_op::gap_helix1 ? 0 : run.length;
+                len2 += run.op == edit_op::gap_helix2 ? 0 : run.length;
+            }
+            REQUIRE(len1 == static_cast<int64_t>(bases.size()));
+            REQUIRE(len2 == static_cast<int64_t>(mutated.size()));
+        }
+}
+
+TEST_CASE("Given a long pair of strands with scattered mutations, wavefront alignment finds every one")
+{
+    std::string bases = random_bases(200000, 5);
+    std::string mutated = bases;
+    std::vector<mutation> expected;
+    for (std::size_t i = 150; i < bases.size(); i += 997)
+    {
+        mutated[i] = other_base(mutated[i]);
+        expected.emplace_back(location{static_cast<int64_t>(i), 1}, location{static_cast<int64_t>(i), 1});
+    }
+
+    REQUIRE(wfa_align(bases, mutated).mutations == expected);
+    REQUIRE(wfa_align(bases, mutated, 1 << 10).mutations == expected);
+}
+
+TEST_CASE("Given strands of different length, wavefront alignment reports the missing tail")
+{
+    std::string bases = random_bases(3000, 6);
+
+    alignment_result shorter = wfa_align(bases, bases.substr(0, 2990));
+    REQUIRE(shorter.mutations.size() == 1);
+    REQUIRE(shorter.mutations[0] == mutation(location{2990, 10}, location{2990, 0}));
+
+    alignment_result longer = wfa_align(bases.substr(0, 1000), bases);
+    REQUIRE(longer.mutations.size() == 1);
+    REQUIRE(longer.mutations[0] == mutation(location{1000, 0}, location{1000, 2000}));
+}
+
+TEST_CASE("Given an empty strand, wavefront alignment reports an error")
+{
+    REQUIRE(wfa_align("", "").similarity_score == 1);
+    REQUIRE(wfa_align("ACGT", "").error == NoDataErr);
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include "fogsaa.hpp"
+#include "edit_transcript.hpp"
+#include "packed_sequence.hpp"
+#include "person.hpp"
+#include "sequence_aligner.hpp"
+
+namespace dna
+{
+
+// Aligns two helixes without loading either of them completely. Chunks are read from both
+// streams in lockstep into a window of window_size bases per helix and the window is aligned
+// with FOGSAA. Only the part of the alignment that ends at least overlap bases before the end
+// of the window is committed (the end of a window is arbitrary, so the alignment close to it
+// can change once more bases are seen). The uncommitted tail is carried into the next window.
+//
+// Memory is bounded by the window size instead of the chromosome length, and alignment
+// starts as soon as the first window has been read.
+class windowed_alignment
+{
+    packed_sequence w1_;
+    packed_sequence w2_;
+    int64_t offset1_ = 0; // helix offset of the first base of each window
+    int64_t offset2_ = 0;
+    bool done1_ = false;
+    bool done2_ = false;
+    std::size_t window_;
+    std::size_t overlap_;
+
+    template<HelixStream T>
+    static void fill(T& helix, packed_sequence& window, bool& done, std::size_t target)
+    {
+        while (!done && window.size() < target)
+        {
+            auto buf = helix.read();
+            if (buf.size() == 0)
+                done = true;
+            else
+                window.append(buf);
+        }
+    }
+
+    // Finds the furthest point inside (or at the start of) a run of matches where both
+    // helixes are within their limits. Cutting there never splits a mutation.
+    static void find_cut(const edit_transcript& transcript, int64_t limit1, int64_t limit2,
+            int64_t& cut1, int64_t& cut2, std::size_t& cut_run, int64_t& cut_len)
+    {
+        int64_t s1 = 0, s2 = 0;
+        const auto& runs = transcript.runs();
+        for (std::size_t i = 0; i < runs.size(); ++i)
+        {
+            const edit_run& run = runs[i];
+            if (run.op == edit_op::match)
+            {
+                int64_t k = std::min(run.length, std::min(limit1 - s1, limit2 - s2));
+                if (k >= 0 && (s1 + k) + (s2 + k) > cut1 + cut2)
+                {
+                    cut1 = s1 + k;
+                    cut2 = s2 + k;
+                    cut_run = i;
+                    cut_len = k;
+                }
+            }
+
+            if (run.op != edit_op::gap_helix1)
+                s1 += run.length;
+            if (run.op != edit_op::gap_helix2)
+                s2 += run.length;
+            if (s1 > limit1 && s2 > limit2)
+                break;
+        }
+    }
+
+public:
+    windowed_alignment(std::size_t window_size, std::size_t overlap)
+        : window_(window_size), overlap_(std::min(overlap, window_size / 2))
+    {}
+
+    // Aligns the next window, passing every mutation it commits to on_mutation. Returns false
+    // once both helixes have been fully aligned.
+    template<HelixStream T, typename F>
+    bool step(T& helix1, T& helix2, F& on_mutation)
+    {
+        fill(helix1, w1_, done1_, window_);
+        fill(helix2, w2_, done2_, window_);
+        if (w1_.empty() && w2_.empty())
+            return false;
+
+        edit_transcript transcript = fogsaa::transcribe(w1_.view(), w2_.view());
+
+        // The end of a helix is a real end, the end of a window is not.
+        int64_t size1 = w1_.size(), size2 = w2_.size(), overlap = overlap_;
+        int64_t limit1 = done1_ ? size1 : size1 - overlap;
+        int64_t limit2 = done2_ ? size2 : size2 - overlap;
+
+        edit_transcript committed;
+        int64_t cut1 = 0, cut2 = 0;
+        if (done1_ && done2_)
+        {
+            committed = std::move(transcript);
+            cut1 = size1;
+            cut2 = size2;
+        } else
+        {
+            std::size_t cut_run = 0;
+            int64_t cut_len = 0;
+            find_cut(transcript, limit1, limit2, cut1, cut2, cut_run, cut_len);
+
+            if (cut1 + cut2 == 0)
+            {
+                // The whole window is one difference, commit all of it to make progress
+                // (the mutation is split at the window boundary).
+                committed = std::move(transcript);
+                cut1 = size1;
+                cut2 = size2;
+            } else
+            {
+                const auto& runs = transcript.runs();
+                for (std::size_t i = 0; i < cut_run; ++i)
+                    committed.push(runs[i].op, runs[i].length);
+                committed.push(edit_op::match, cut_len);
+            }
+        }
+
+        for (auto& mut : committed.mutations(offset1_, offset2_))
+            on_mutation(mut);
+
+        w1_.erase_front(cut1);
+        w2_.erase_front(cut2);
+        offset1_ += cut1;
+        offset2_ += cut2;
+
+        return !(done1_ && done2_ && w1_.empty() && w2_.empty());
+    }
+
+    int64_t helix1_aligned() const
+    {
+        return offset1_;
+    }
+
+    int64_t helix2_aligned() const
+    {
+        return offset2_;
+    }
+};
+
+template<HelixStream T>
+class windowed_aligner : public sequence_aligner<T>
+{
+    std::size_t window_;
+    std::size_t overlap_;
+
+public:
+    explicit windowed_aligner(std::size_t window_size = 1 << 16, std::size_t overlap = 1 << 12)
+        : window_(window_size), overlap_(overlap)
+    {}
+
+    // Aligns the helixes reporting each mutation to on_mutation as soon as it is committed.
+    // The returned result holds the similarity score (and any error) but no mutations.
+    template<typename F>
+    alignment_result align(T& a, T& b, F on_mutation) const
+    {
+        alignment_result res;
+        if (a.size() == 0 && b.size() == 0)
+        {
+            res.similarity_score = 1;
+            return res;
+        }
+
+        if (a.size() == 0 || b.size() == 0)
+        {
+            res.error = NoDataErr;
+            return res;
+        }
+
+        double total_muts = 0;
+        auto collect = [&](const mutation& mut)
+        {
+            total_muts += mut.helix1.length;
+            on_mutation(mut);
+        };
+
+        windowed_alignment alignment(window_, overlap_);
+        while (alignment.step(a, b, collect));
+
+        res.similarity_score = 1 - (total_muts /
+                std::max(alignment.helix1_aligned(), alignment.helix2_aligned()));
+        return res;
+    }
+
+    alignment_result align(T& a, T& b) const override
+    {
+        std::vector<mutation> muts;
+        alignment_result res = align(a, b, [&muts](const mutation& mut) { muts.push_back(mut); });
+        res.mutations = std::move(muts);
+        return res;
+    }
+};
+
+} // dna
@@ -0,0 +1,77 @@
+#include "catch.hpp"
+#include "windowed_aligner.hpp"
+#include "fake_stream.hpp"
+#include "fake_person_factory.hpp"
+#include <sstream>
+
+using namespace dna;
+
+static std::string fake_bases()
+{
+    std::vector<std::byte> data = data::fake();
+    dna::sequence_buffer<std::vector<std::byte>> buf(data);
+    std::ostringstream out;
+    out << buf;
+    return out.str();
+}
+
+TEST_CASE("Given two stands with same large fake data, windowed alignment finds no mutations")
+{
+    fake_stream s1(data::fake(), 16);
+    fake_stream s2(data::fake(), 16);
+
+    windowed_aligner<fake_stream> aligner(256, 64);
+    alignment_result res = aligner.align(s1, s2);
+    REQUIRE(res.mutations.size() == 0);
+    REQUIRE(res.similarity_score == 1.0);
+}
+
+TEST_CASE("Given mutations across several windows, windowed alignment matches a full alignment")
+{
+    std::string bases = fake_bases();
+    std::string mutated = bases;
+    mutated[100] = mutated[100] == 'A' ? 'C' : 'A';
+    mutated[1000] = mutated[1000] == 'G' ? 'T' : 'G';
+    mutated.erase(2500, 2);
+    mutated.insert(3000, "ACG");
+
+    fake_stream full1(bases, 64), full2(mutated, 64);
+    alignment_result expected = fogsaa::align(full1, full2);
+
+    fake_stream s1(bases, 16), s2(mutated, 16);
+    windowed_aligner<fake_stream> aligner(256, 64);
+    alignment_result res = aligner.align(s1, s2);
+
+    REQUIRE(res.error.empty());
+    REQUIRE(res.mutations.size() >= 4);
+    for (std::size_t i = 0; i < 3; ++i)
+        REQUIRE(res.mutations[i] == expected.mutations[i]);
+
+    // The inserted bases may be placed differently, but must all be accounted for after the
+    // deletion.
+    int64_t removed = 0, inserted = 0;
+    for (std::size_t i = 3; i < res.mutations.size(); ++i)
+    {
+        REQUIRE(res.mutations[i].helix2.offset >= 2998);
+        removed += res.mutations[i].helix1.length;
+        inserted += res.mutations[i].helix2.length;
+    }
+    REQUIRE(inserted - removed == 3);
+    REQUIRE(res.similarity_score == expected.similarity_score);
+}
+
+TEST_CASE("Windowed alignment reports mutations incrementally")
+{
+    fake_stream s1("ACGTACGTACGTACGTACGTACGTACGTACGT", 2);
+    fake_stream s2("ACGTACGTACTTACGTACGTACGTACGTACGT", 2);
+
+    std::vector<mutation> reported;
+    windowed_aligner<fake_stream> aligner(16, 4);
+    alignment_result res = aligner.align(s1, s2, [&reported](const mutation& mut) { reported.push_back(mut); });
+
+    REQUIRE(res.mutations.empty());
+    REQUIRE(reported.size() == 1);
+
+    mutation mut{location{10,1}, location{10,1}};
+    REQUIRE(reported[0] == mut);
+}
@@ -0,0 +1,113 @@
+#include "catch.hpp"
+#include "fogsaa.hpp"
+#include "fake_stream.hpp"
+#include "test_sequences.hpp"
+#include <xdrop_aligner.hpp>
+
+using namespace dna;
+
+static alignment_result xdrop_align(const std::string& a, const std::string& b, int64_t band = 32,
+        int64_t fallback_window = 1 << 12)
+{
+    fake_stream s1(a, 512), s2(b, 512);
+    fogsaa_aligner<packed_stream> fogsaa;
+    xdrop_aligner<fake_stream> aligner(fogsaa, band, 64, fallback_window);
+    return aligner.align(s1, s2);
+}
+
+static alignment_result fogsaa_align(const std::string& a, const std::string& b)
+{
+    fake_stream s1(a, 512), s2(b, 512);
+    return fogsaa::align(s1, s2);
+}
+
+static int64_t helix_total(const std::vector<mutation>& muts, bool helix1)
+{
+    int64_t total = 0;
+    for (auto& mut : muts)
+        total += helix1 ? mut.helix1.length : mut.helix2.length;
+    return total;
+}
+
+TEST_CASE("Given identical strands, x-drop alignment finds no mutations")
+{
+    std::string bases = random_bases(10000, 1);
+    alignment_result res = xdrop_align(bases, bases);
+
+    REQUIRE(res.error.empty());
+    REQUIRE(res.mutations.size() == 0);
+    REQUIRE(res.similarity_score == 1);
+}
+
+TEST_CASE("Given point mutations, x-drop alignment agrees with FOGSAA")
+{
+    std::string bases = random_bases(8000, 2);
+    std::string mutated = bases;
+    for (std::size_t i : { 10, 700, 701, 2500, 5003, 7990 })
+        mutated[i] = other_base(mutated[i]);
+
+    alignment_result res = xdrop_align(bases, mutated);
+    alignment_result expected = fogsaa_align(bases, mutated);
+
+    REQUIRE(res.mutations.size() == 5);
+    REQUIRE(res.mutations[1] == mutation(location{700, 2}, location{700, 2}));
+    REQUIRE(res.mutations == expected.mutations);
+    REQUIRE(res.similarity_score == expected.similarity_score);
+}
+
+TEST_CASE("Given small indels, x-drop alignment finds them without the exact engine")
+{
+    std::string bases = random_bases(8000, 3);
+    std::string mutated = bases.substr(0, 1000) + "GATTACA" + bases.substr(1000, 3000) + bases.substr(4005);
+
+    alignment_result res = xdrop_align(bases, mutated);
+
+    // Placing the gaps is ambiguous when inserted bases happen to match, only the totals and
+    // the neighbourhood are fixed.
+    REQUIRE(helix_total(res.mutations, true) == 5);
+    REQUIRE(helix_total(res.mutations, false) == 7);
+    for (auto& mut : res.mutations)
+    {
+        bool insertion = mut.helix1.offset >= 1000 && mut.helix1.offset <= 1007;
+        bool deletion = mut.helix1.offset >= 3995 && mut.helix1.offset <= 4010;
+        REQUIRE((insertion || deletion));
+    }
+    REQUIRE(res.similarity_score == 1 - 5.0 / 8002);
+}
+
+TEST_CASE("Given an insertion wider than the band, x-drop alignment falls back to the exact engine")
+{
+    std::string bases = random_bases(6000, 4);
+    std::string insertion = random_bases(40, 5);
+    std::string mutated = bases.substr(0, 2000) + insertion + bases.substr(2000);
+
+    alignment_result res = xdrop_align(bases, mutated, 16, 1024);
+
+    REQUIRE(res.error.empty());
+    REQUIRE(res.mutations.size() > 0);
+    REQUIRE(helix_total(res.mutations, false) - helix_total(res.mutations, true) == 40);
+    for (auto& mut : res.mutations)
+    {
+        REQUIRE(mut.helix1.offset >= 2000);
+        REQUIRE(mut.helix1.offset + mut.helix1.length <= 2100);
+    }
+}
+
+TEST_CASE("Given strands of different length, x-drop alignment reports the missing tail")
+{
+    std::string bases = random_bases(3000, 6);
+
+    alignment_result shorter = xdrop_align(bases, bases.substr(0, 2990));
+    REQUIRE(shorter.mutations.size() == 1);
+    REQUIRE(shorter.mutations[0] == mutation(location{2990, 10}, location{2990, 0}));
+
+    alignment_result longer = xdrop_align(bases.substr(0, 1000), bases);
+    REQUIRE(longer.mutations.size() == 1);
+    REQUIRE(longer.mutations[0] == mutation(location{1000, 0}, location{1000, 2000}));
+}
+
+TEST_CASE("Given an empty strand, x-drop alignment reports an error")
+{
+    REQUIRE(xdrop_align("", "").similarity_score == 1);
+    REQUIRE(xdrop_align("ACGT", "").error == "A stream did not have data");
+}
@@ -13,19 +13,231 @@
 //   misrepresented as being the original software.
 //   3. This notice may not be removed or altered from any source
 //   distribution.
+//
+//ALTERED: the single mutex guarded task queue of the original was replaced with
+//per worker Chase-Lev work stealing deques, randomized stealing and eventcount
+//based parking. wait() was added so tasks can wait for the tasks they enqueue.
 
 #ifndef THREAD_POOL_H
 #define THREAD_POOL_H
 
 #include <vector>
-#include <queue>
+#include <deque>
 #include <memory>
 #include <thread>
 #include <mutex>
+#include <atomic>
 #include <condition_variable>
+#include <chrono>
 #include <future>
 #include <functional>
 #include <stdexcept>
+#include <cstdint>
+
+namespace detail
+{
+
+// A unit of work. Tasks are allocated once on enqueue and deleted after running.
+struct pool_task
+{
+    virtual ~pool_task() {}
+    virtual void run() = 0;
+};
+
+template<class F, class R>
+struct promised_task : pool_task
+{
+    F fn;
+    std::promise<R> promise;
+
+    explicit promised_task(F&& f) : fn(std::move(f)) {}
+
+    void run() override
+    {
+        try {
+            promise.set_value(fn());
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+        }
+    }
+};
+
+template<class F>
+struct promised_task<F, void> : pool_task
+{
+    F fn;
+    std::promise<void> promise;
+
+    explicit promised_task(F&& f) : fn(std::move(f)) {}
+
+    void run() override
+    {
+        try {
+            fn();
+            promise.set_value();
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+        }
+    }
+};
+
+// Chase-Lev work stealing deque (Lê et al, "Correct and Efficient Work-Stealing for Weak
+// Memory Models"). Only the owning worker pushes and pops at the bottom, any thread may
+// steal from the top.
+class work_deque
+{
+    struct ring
+    {
+        int64_t capacity;
+        std::unique_ptr<std::atomic<pool_task*>[]> slots;
+
+        explicit ring(int64_t cap) : capacity(cap), slots(new std::atomic<pool_task*>[cap]) {}
+
+        pool_task* get(int64_t i) const
+        {
+            return slots[i & (capacity - 1)].load(std::memory_order_relaxed);
+        }
+
+        void put(int64_t i, pool_task* t)
+        {
+            slots[i & (capacity - 1)].store(t, std::memory_order_relaxed);
+        }
+    };
+
+    std::atomic<int64_t> top_;
+    std::atomic<int64_t> bottom_;
+    std::atomic<ring*> ring_;
+    std::vector<std::unique_ptr<ring>> rings_; // every ring ever used, thieves may still read old ones
+
+public:
+    work_deque() : top_(0), bottom_(0)
+    {
+        rings_.emplace_back(new ring(256));
+        ring_.store(rings_.back().get(), std::memory_order_relaxed);
+    }
+
+    void push(pool_task* t)
+    {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t top = top_.load(std::memory_order_acquire);
+        ring* r = ring_.load(std::memory_order_relaxed);
+
+        if (b - top > r->capacity - 1)
+        {
+            ring* bigger = new ring(r->capacity * 2);
+            for (int64_t i = top; i < b; ++i)
+                bigger->put(i, r->get(i));
+            rings_.emplace_back(bigger);
+            ring_.store(bigger, std::memory_order_release);
+            r = bigger;
+        }
+
+        r->put(b, t);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+
+    pool_task* pop()
+    {
+        int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        ring* r = ring_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+
+        if (t > b)
+        {
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        pool_task* task = r->get(b);
+        if (t == b)
+        {
+            // last task, race thieves for it
+            if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                task = nullptr;
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+        return task;
+    }
+
+    pool_task* steal()
+    {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom_.load(std::memory_order_acquire);
+        if (t >= b)
+            return nullptr;
+
+        ring* r = ring_.load(std::memory_order_acquire);
+        pool_task* task = r->get(t);
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+        return task;
+    }
+
+    bool empty() const
+    {
+        return top_.load(std::memory_order_acquire) >= bottom_.load(std::memory_order_acquire);
+    }
+};
+
+// Lets idle workers sleep without missing work. A worker announces it is about to wait,
+// checks for work once more and only then blocks; a notifier bumps the epoch so a waiter
+// that announced before the work was published never sleeps through it.
+class event_count
+{
+    static const uint64_t waiter_mask = 0xffffffffULL;
+    static const uint64_t epoch_inc = 1ULL << 32;
+
+    std::atomic<uint64_t> state_;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+
+public:
+    event_count() : state_(0) {}
+
+    uint64_t prepare_wait()
+    {
+        return state_.fetch_add(1, std::memory_order_seq_cst);
+    }
+
+    void cancel_wait()
+    {
+        state_.fetch_sub(1, std::memory_order_seq_cst);
+    }
+
+    void wait(uint64_t key)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cond_.wait(lock, [this, key] {
+                return (state_.load(std::memory_order_acquire) & ~waiter_mask) != (key & ~waiter_mask);
+            });
+        }
+        state_.fetch_sub(1, std::memory_order_seq_cst);
+    }
+
+    void notify(bool all)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!all && (state_.load(std::memory_order_acquire) & waiter_mask) == 0)
+            return;
+
+        state_.fetch_add(epoch_inc, std::memory_order_seq_cst);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+        }
+
+        if (all)
+            cond_.notify_all();
+        else
+            cond_.notify_one();
+    }
+};
+
+} // detail
 
 class thread_pool {
 public:
@@ -33,45 +245,57 @@ public:
     template<class F, class... Args>
     auto enqueue(F&& f, Args&&... args)
         -> std::future<typename std::result_of<F(Args...)>::type>;
+    // wait for a future of a task enqueued on this pool. a worker of this pool runs
+    // other queued tasks until the future is ready, so tasks can wait for tasks they
+    // enqueued without every worker blocking.
+    template<class R>
+    R wait(std::future<R>& future);
     ~thread_pool();
 private:
+    struct worker_state
+    {
+        detail::work_deque tasks;
+        uint64_t rng;
+    };
+
+    // the pool and worker the current thread belongs to (if any)
+    static thread_local thread_pool* current_pool;
+    static thread_local worker_state* current_worker;
+
     // need to keep track of threads so we can join them
     std::vector< std::thread > workers;
-    // the task queue
-    std::queue< std::function<void()> > tasks;
+    std::vector< std::unique_ptr<worker_state> > states;
 
-    // synchronization
-    std::mutex queue_mutex;
-    std::condition_variable condition;
-    bool stop;
+    // tasks enqueued from threads outside of the pool
+    std::deque< detail::pool_task* > injected;
+    std::mutex injected_mutex;
+
+    detail::event_count idle;
+    std::atomic<bool> stop;
+
+    void submit(detail::pool_task* task);
+    detail::pool_task* find_task(worker_state& self);
+    bool has_work();
+    bool stopped_and_drained();
+    void worker_main(worker_state& self);
 };
 
+inline thread_local thread_pool* thread_pool::current_pool = nullptr;
+inline thread_local thread_pool::worker_state* thread_pool::current_worker = nullptr;
+
 // the constructor just launches some amount of workers
 inline thread_pool::thread_pool(size_t threads)
     :   stop(false)
 {
+    threads = std::max<size_t>(threads, 1);
     for(size_t i = 0;i<threads;++i)
-        workers.emplace_back(
-            [this]
-            {
-                for(;;)
-                {
-                    std::function<void()> task;
-
-                    {
-                        std::unique_lock<std::mutex> lock(this->queue_mutex);
-                        this->condition.wait(lock,
-                            [this]{ return this->stop || !this->tasks.empty(); });
-                        if(this->stop && this->tasks.empty())
-                            return;
-                        task = std::move(this->tasks.front());
-                        this->tasks.pop();
-                    }
-
-                    task();
-                }
-            }
-        );
+    {
+        states.emplace_back(new worker_state());
+        states.back()->rng = 0x9E3779B97F4A7C15ULL * (i + 1);
+    }
+
+    for(size_t i = 0;i<threads;++i)
+        workers.emplace_back([this, i] { worker_main(*states[i]); });
 }
 
 // add new work item to the pool
@@ -80,33 +304,144 @@ auto thread_pool::enqueue(F&& f, Args&&... args)
     -> std::future<typename std::result_of<F(Args...)>::type>
 {
     using return_type = typename std::result_of<F(Args...)>::type;
+    using bound_type = decltype(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
 
-    auto task = std::make_shared< std::packaged_task<return_type()> >(
-            std::bind(std::forward<F>(f), std::forward<Args>(args)...)
-        );
+    std::unique_ptr<detail::promised_task<bound_type, return_type>> task(
+            new detail::promised_task<bound_type, return_type>(
+                std::bind(std::forward<F>(f), std::forward<Args>(args)...)));
+    std::future<return_type> res = task->promise.get_future();
+    submit(task.get());
+    task.release();
+    return res;
+}
 
-    std::future<return_type> res = task->get_future();
+template<class R>
+R thread_pool::wait(std::future<R>& future)
+{
+    if(current_pool == this)
     {
-        std::unique_lock<std::mutex> lock(queue_mutex);
+        while(future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            detail::pool_task* task = find_task(*current_worker);
+            if(task == nullptr)
+            {
+                // the task is running elsewhere, check back shortly in case it enqueues more
+                future.wait_for(std::chrono::microseconds(50));
+                continue;
+            }
+            task->run();
+            delete task;
+        }
+    }
+    return future.get();
+}
+
+// a worker pushes onto its own deque and runs it before it exits, even once the pool is
+// stopping. other threads go through the injection queue, where stop is checked under the
+// same lock the destructor sets it with, so a task is either refused or run.
+inline void thread_pool::submit(detail::pool_task* task)
+{
+    if(current_pool == this)
+    {
+        current_worker->tasks.push(task);
+    }
+    else
+    {
+        std::unique_lock<std::mutex> lock(injected_mutex);
 
         // don't allow enqueueing after stopping the pool
-        if(stop)
+        if(stop.load(std::memory_order_relaxed))
             throw std::runtime_error("enqueue on stopped thread_pool");
 
-        tasks.emplace([task](){ (*task)(); });
+        injected.push_back(task);
+    }
+    idle.notify(false);
+}
+
+inline detail::pool_task* thread_pool::find_task(worker_state& self)
+{
+    if(detail::pool_task* task = self.tasks.pop())
+        return task;
+
+    // steal from a random victim, then walk the others
+    const size_t count = states.size();
+    self.rng ^= self.rng << 13;
+    self.rng ^= self.rng >> 7;
+    self.rng ^= self.rng << 17;
+    size_t start = static_cast<size_t>(self.rng % count);
+    for(size_t i = 0;i<count;++i)
+    {
+        worker_state& victim = *states[(start + i) % count];
+        if(&victim == &self)
+            continue;
+        if(detail::pool_task* task = victim.tasks.steal())
+            return task;
+    }
+
+    std::unique_lock<std::mutex> lock(injected_mutex);
+    if(injected.empty())
+        return nullptr;
+    detail::pool_task* task = injected.front();
+    injected.pop_front();
+    return task;
+}
+
+// whether the pool is stopping and no task can still be injected. stop is set under the
+// injection lock, so once it reads true here every task enqueued before it is in the queue.
+inline bool thread_pool::stopped_and_drained()
+{
+    std::unique_lock<std::mutex> lock(injected_mutex);
+    return stop.load(std::memory_order_relaxed) && injected.empty();
+}
+
+inline bool thread_pool::has_work()
+{
+    for(auto& state : states)
+        if(!state->tasks.empty())
+            return true;
+
+    std::unique_lock<std::mutex> lock(injected_mutex);
+    return !injected.empty();
+}
+
+inline void thread_pool::worker_main(worker_state& self)
+{
+    current_pool = this;
+    current_worker = &self;
+
+    for(;;)
+    {
+        detail::pool_task* task = find_task(self);
+        if(task == nullptr)
+        {
+            uint64_t key = idle.prepare_wait();
+            if(has_work())
+            {
+                idle.cancel_wait();
+                continue;
+            }
+            if(stopped_and_drained())
+            {
+                idle.cancel_wait();
+                return;
+            }
+            idle.wait(key);
+            continue;
+        }
+
+        task->run();
+        delete task;
     }
-    condition.notify_one();
-    return res;
 }
 
 // the destructor joins all threads
 inline thread_pool::~thread_pool()
 {
     {
-        std::unique_lock<std::mutex> lock(queue_mutex);
-        stop = true;
+        std::unique_lock<std::mutex> lock(injected_mutex);
+        stop.store(true, std::memory_order_relaxed);
     }
-    condition.notify_all();
+    idle.notify(true);
     for(std::thread &worker: workers)
         worker.join();
 }
@@ -0,0 +1,417 @@
+#pragma once
+
+#include "edit_transcript.hpp"
+#include "packed_stream.hpp"
+#include "person.hpp"
+#include "scoring.hpp"
+#include "sequence_aligner.hpp"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace dna {
+
+// Penalties of the edits of an alignment, the best alignment is the one with the lowest total.
+// A gap of n bases costs gap_open + n * gap_extend, gap_open 0 makes gaps linear.
+//
+// The defaults give the same alignments as FOGSAA's scores (+1 match, -1 mismatch, -2 per gap
+// base): over a pair of helixes those add up to (n1 + n2) / 2 - 2 mismatches - 2.5 gap bases,
+// so the highest score is the lowest 4 mismatches + 5 gap bases.
+struct wfa_penalties
+{
+    int64_t mismatch = 4;
+    int64_t gap_open = 0;
+    int64_t gap_extend = 5;
+};
+
+// The penalties that rank alignments the same as a scoring policy. Over a pair of helixes a
+// policy's scores add up to (n1 + n2) * match / 2 - (match - mismatch) mismatches - (match / 2 -
+// gap_extend) gap bases + gap_open per gap, twice the penalties taken off are integers. The
+// wavefronts only know one mismatch penalty, policies that score substitutions apart (such as
+// transition_scoring) are rejected.
+template<ScoringPolicy S>
+constexpr wfa_penalties to_penalties(const S& scoring)
+{
+    if (!uniform_substitutions(scoring))
+        throw std::invalid_argument("wavefront alignment needs one score for every mismatch");
+
+    int64_t match = scoring.substitution(A, A), mismatch = scoring.substitution(A, C);
+    int64_t gap_open = scoring.gap_open(), gap_extend = scoring.gap_extend();
+    return wfa_penalties{2 * (match - mismatch), -2 * gap_open, match - 2 * gap_extend};
+}
+
+// Wavefront alignment (WFA): finds the best global alignment of two helixes in time that grows
+// with the penalty of the alignment rather than with the product of their lengths. For every
+// penalty s it keeps, per diagonal, the furthest point an alignment of penalty s reaches, and
+// slides each point along its diagonal while the helixes match, comparing a word (32 bases) at
+// a time. Near identical helixes are mostly slid over.
+//
+// The wavefronts are kept for a traceback while they fit in max_cells cells. Alignments with a
+// higher penalty are split in two where the best alignment crosses the middle of helix 1 and
+// each half is aligned on its own, so memory stays proportional to the penalty instead of its
+// square. The crossing is found in one pass that only keeps the last few wavefronts, each point
+// carrying where its alignment crossed.
+class wavefront_engine
+{
+    static constexpr int64_t unreached = std::numeric_limits<int64_t>::min() / 4;
+    static constexpr int64_t no_crossing = std::numeric_limits<int64_t>::min();
+
+    // The part of the helixes being aligned. If start_gap the alignment continues a gap in
+    // helix 2 (bases only present in helix 1) that was already opened, if end_gap it must end
+    // in one.
+    struct range
+    {
+        int64_t x0;
+        int64_t n1;
+        int64_t y0;
+        int64_t n2;
+        bool start_gap;
+        bool end_gap;
+    };
+
+    // Furthest offsets in helix 1 reached on diagonals lo..hi (helix 2 offset - helix 1
+    // offset) by alignments ending in a match or mismatch (m, which also takes the other two),
+    // in a gap in helix 1 (i) or in a gap in helix 2 (d). When splitting, each point also
+    // carries where its alignment crossed the middle.
+    struct wavefront
+    {
+        int64_t lo = 0;
+        int64_t hi = -1;
+        std::vector<int64_t> m, i, d;
+        std::vector<int64_t> mc, ic, dc;
+
+        bool empty() const
+        {
+            return hi < lo;
+        }
+
+        void reset(int64_t l, int64_t h, bool crossings)
+        {
+            lo = l;
+            hi = h;
+            std::size_t width = h < l ? 0 : static_cast<std::size_t>(h - l + 1);
+            m.assign(width, unreached);
+            i.assign(width, unreached);
+            d.assign(width, unreached);
+            mc.assign(crossings ? width : 0, no_crossing);
+            ic.assign(crossings ? width : 0, no_crossing);
+            dc.assign(crossings ? width : 0, no_crossing);
+        }
+    };
+
+    wfa_penalties pen_;
+    std::size_t max_cells_;
+    sequence_buffer<byte_span> v1_;
+    sequence_buffer<byte_span> v2_;
+    std::vector<wavefront> fronts_; // by penalty, or a ring of the last ones when splitting
+    bool ring_ = false;
+    int64_t lookback_;
+
+    const wavefront* front(int64_t s) const
+    {
+        if (s < 0)
+            return nullptr;
+        if (ring_)
+            return &fronts_[s % fronts_.size()];
+        return s < static_cast<int64_t>(fronts_.size()) ? &fronts_[s] : nullptr;
+    }
+
+    static int64_t get(const wavefront* w, const std::vector<int64_t> wavefront::*comp, int64_t k)
+    {
+        if (w == nullptr || k < w->lo || k > w->hi)
+            return unreached;
+        return (w->*comp)[k - w->lo];
+    }
+
+    static int64_t crossing(int64_t k, bool gap)
+    {
+        return k * 2 + (gap ? 1 : 0);
+    }
+
+    // Computes wavefronts until the end of r is reached and returns its penalty. Without mid
+    // every wavefront is kept, giving up (returning -1) once they take more than budget cells.
+    // With mid only the last few are kept and crossing is set to where the alignment crossed
+    // mid in helix 1.
+    int64_t forward(const range& r, std::size_t budget, int64_t mid, int64_t& cross)
+    {
+        const bool split = mid > 0;
+        const int64_t k_end = r.n2 - r.n1;
+        auto end_comp = r.end_gap ? &wavefront::d : &wavefront::m;
+        auto end_cross = r.end_gap ? &wavefront::dc : &wavefront::mc;
+
+        ring_ = split;
+        fronts_.clear();
+        if (split)
+            fronts_.resize(lookback_ + 1);
+
+        std::size_t cells = 0;
+        for (int64_t s = 0; ; ++s)
+        {
+            if (!split)
+                fronts_.emplace_back();
+            wavefront& w = fronts_[split ? s % fronts_.size() : s];
+
+            if (s == 0)
+            {
+                w.reset(0, 0, split);
+                if (r.start_gap)
+                    w.d[0] = 0;
+                int64_t x = match_run(v1_, r.x0, v2_, r.y0, std::min(r.n1, r.n2));
+                w.m[0] = x;
+                if (split && x >= mid)
+                    w.mc[0] = crossing(0, false);
+            } else
+            {
+                next(r, s, w, split ? mid : 0);
+            }
+
+            if (get(&w, end_comp, k_end) == r.n1)
+            {
+                if (split)
+                    cross = (w.*end_cross)[k_end - w.lo];
+                return s;
+            }
+
+            cells += w.empty() ? 0 : 3 * static_cast<std::size_t>(w.hi - w.lo + 1);
+            if (!split && cells > budget)
+                return -1;
+        }
+    }
+
+    // Computes the wavefront of penalty s from the ones before it.
+    void next(const range& r, int64_t s, wavefront& w, int64_t mid)
+    {
+        const wavefront* wx = front(s - pen_.mismatch);
+        const wavefront* wo = front(s - pen_.gap_open - pen_.gap_extend);
+        const wavefront* we = front(s - pen_.gap_extend);
+        const bool split = mid > 0;
+
+        int64_t lo = std::numeric_limits<int64_t>::max(), hi = std::numeric_limits<int64_t>::min();
+        if (wx != nullptr && !wx->empty())
+        {
+            lo = std::min(lo, wx->lo);
+            hi = std::max(hi, wx->hi);
+        }
+        for (auto g : { wo, we })
+            if (g != nullptr && !g->empty())
+            {
+                lo = std::min(lo, g->lo - 1);
+                hi = std::max(hi, g->hi + 1);
+            }
+        w.reset(std::max(lo, -r.n1), std::min(hi, r.n2), split);
+
+        for (int64_t k = w.lo; k <= w.hi; ++k)
+        {
+            const std::size_t at = static_cast<std::size_t>(k - w.lo);
+
+            // A gap in helix 1 takes a base of helix 2 only.
+            int64_t open = get(wo, &wavefront::m, k - 1), extend = get(we, &wavefront::i, k - 1);
+            int64_t ins = std::max(open, extend);
+            if (ins != unreached && ins + k <= r.n2)
+            {
+                w.i[at] = ins;
+                if (split)
+                    w.ic[at] = extend == ins ? get(we, &wavefront::ic, k - 1) : get(wo, &wavefront::mc, k - 1);
+            }
+
+            // A gap in helix 2 takes a base of helix 1 only.
+            open = get(wo, &wavefront::m, k + 1);
+            extend = get(we, &wavefront::d, k + 1);
+            int64_t del = std::max(open, extend) + 1;
+            if (del > unreached + 1 && del <= r.n1)
+            {
+                w.d[at] = del;
+                if (split)
+                {
+                    int64_t c = extend + 1 == del ? get(we, &wavefront::dc, k + 1) : get(wo, &wavefront::mc, k + 1);
+                    w.dc[at] = c == no_crossing && del >= mid ? crossing(k, true) : c;
+                }
+            }
+
+            int64_t mis = get(wx, &wavefront::m, k) + 1;
+            if (mis > r.n1 || mis + k > r.n2)
+                mis = unreached;
+
+            int64_t v = std::max({ mis, w.i[at], w.d[at] });
+            if (v < 0)
+                continue;
+
+            int64_t c = no_crossing;
+            if (split)
+            {
+                if (v == mis)
+                {
+                    c = get(wx, &wavefront::mc, k);
+                    if (c == no_crossing && mis >= mid)
+                        c = crossing(k, false);
+                } else
+                {
+                    c = v == w.i[at] ? w.ic[at] : w.dc[at];
+                }
+            }
+
+            int64_t x = v + match_run(v1_, r.x0 + v, v2_, r.y0 + v + k, std::min(r.n1 - v, r.n2 - v - k));
+            w.m[at] = x;
+            if (split)
+                w.mc[at] = c == no_crossing && x >= mid ? crossing(k, false) : c;
+        }
+    }
+
+    // Appends the edits of the alignment found by a full forward() of penalty s to out.
+    void trace(const range& r, int64_t s, edit_transcript& out) const
+    {
+        enum { in_match, in_ins, in_del } state = r.end_gap ? in_del : in_match;
+        int64_t k = r.n2 - r.n1;
+        std::vector<edit_run> runs;
+
+        while (true)
+        {
+            const wavefront* w = front(s);
+            if (state == in_match)
+            {
+                int64_t x = get(w, &wavefront::m, k);
+                if (s == 0)
+                {
+                    runs.push_back(edit_run{edit_op::match, x});
+                    break;
+                }
+
+                int64_t mis = get(front(s - pen_.mismatch), &wavefront::m, k) + 1;
+                int64_t v = std::max({ mis, get(w, &wavefront::i, k), get(w, &wavefront::d, k) });
+                runs.push_back(edit_run{edit_op::match, x - v});
+                if (v == mis)
+                {
+                    runs.push_back(edit_run{edit_op::mismatch, 1});
+                    s -= pen_.mismatch;
+                } else
+                {
+                    state = v == get(w, &wavefront::i, k) ? in_ins : in_del;
+                }
+            } else if (state == in_ins)
+            {
+                int64_t x = get(w, &wavefront::i, k);
+                runs.push_back(edit_run{edit_op::gap_helix1, 1});
+                if (get(front(s - pen_.gap_extend), &wavefront::i, k - 1) == x)
+                {
+                    s -= pen_.gap_extend;
+                } else
+                {
+                    s -= pen_.gap_open + pen_.gap_extend;
+                    state = in_match;
+                }
+                --k;
+            } else
+            {
+                if (s == 0)
+                    break; // the gap continues one from before the range
+                int64_t x = get(w, &wavefront::d, k);
+                runs.push_back(edit_run{edit_op::gap_helix2, 1});
+                if (get(front(s - pen_.gap_extend), &wavefront::d, k + 1) + 1 == x)
+                {
+                    s -= pen_.gap_extend;
+                } else
+                {
+                    s -= pen_.gap_open + pen_.gap_extend;
+                    state = in_match;
+                }
+                ++k;
+            }
+        }
+
+        for (auto it = runs.rbegin(); it != runs.rend(); ++it)
+            out.push(it->op, it->length);
+    }
+
+    void align(const range& r, edit_transcript& out)
+    {
+        if (r.n1 == 0 || r.n2 == 0)
+        {
+            out.push(edit_op::gap_helix2, r.n1);
+            out.push(edit_op::gap_helix1, r.n2);
+            return;
+        }
+
+        int64_t cross = no_crossing;
+        std::size_t budget = r.n1 < 2 ? std::numeric_limits<std::size_t>::max() : max_cells_;
+        int64_t s = forward(r, budget, 0, cross);
+        if (s >= 0)
+        {
+            trace(r, s, out);
+            return;
+        }
+
+        int64_t mid = r.n1 / 2;
+        forward(r, 0, mid, cross);
+        bool gap = (cross & 1) != 0;
+        int64_t y = mid + (cross >> 1);
+
+        align(range{r.x0, mid, r.y0, y, r.start_gap, gap}, out);
+        align(range{r.x0 + mid, r.n1 - mid, r.y0 + y, r.n2 - y, gap, r.end_gap}, out);
+    }
+
+public:
+    explicit wavefront_engine(wfa_penalties penalties = wfa_penalties(), std::size_t max_cells = 1 << 22)
+        : pen_(penalties), max_cells_(std::max<std::size_t>(max_cells, 64)), v1_(byte_span()), v2_(byte_span())
+    {
+        pen_.mismatch = std::max<int64_t>(pen_.mismatch, 1);
+        pen_.gap_open = std::max<int64_t>(pen_.gap_open, 0);
+        pen_.gap_extend = std::max<int64_t>(pen_.gap_extend, 1);
+        lookback_ = std::max(pen_.mismatch, pen_.gap_open + pen_.gap_extend);
+    }
+
+    // The edits of the best alignment of two loaded helixes.
+    edit_transcript transcribe(const sequence_buffer<byte_span>& s1, const sequence_buffer<byte_span>& s2)
+    {
+        v1_ = s1;
+        v2_ = s2;
+
+        edit_transcript out;
+        align(range{0, static_cast<int64_t>(s1.size()), 0, static_cast<int64_t>(s2.size()), false, false}, out);
+        fronts_.clear();
+        return out;
+    }
+};
+
+// Aligns helix pairs with a wavefront_engine. Finds the same (best scoring) alignments as
+// FOGSAA with the default penalties, at a cost that grows with the number of differences.
+template<HelixStream T>
+class wfa_aligner : public sequence_aligner<T>
+{
+    wfa_penalties penalties_;
+    std::size_t max_cells_;
+
+public:
+    explicit wfa_aligner(wfa_penalties penalties = wfa_penalties(), std::size_t max_cells = 1 << 22)
+        : penalties_(penalties), max_cells_(max_cells)
+    {}
+
+    alignment_result align(T& a, T& b) const override
+    {
+        alignment_result res;
+        if (a.size() == 0 && b.size() == 0)
+        {
+            res.similarity_score = 1;
+            return res;
+        }
+
+        if (a.size() == 0 || b.size() == 0)
+        {
+            res.error = NoDataErr;
+            return res;
+        }
+
+        helix_bases s1 = read_helix(a);
+        helix_bases s2 = read_helix(b);
+        wavefront_engine engine(penalties_, max_cells_);
+        res.mutations = engine.transcribe(s1.view(), s2.view()).mutations();
+
+        double total_muts = 0;
+        for (auto& mut : res.mutations)
+            total_muts += mut.helix1.length;
+        res.similarity_score = 1 - (total_muts / std::max(s1.size(), s2.size()));
+        return res;
+    }
+};
+
+} // dna
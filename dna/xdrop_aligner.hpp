@@ -0,0 +1,283 @@
+#pragma once
+
+#include "edit_transcript.hpp"
+#include "packed_stream.hpp"
+#include "person.hpp"
+#include "sequence_aligner.hpp"
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace dna {
+
+// Resolves one difference between two helixes with a banded greedy (O(ND)) wavefront: for
+// every number of edits d it keeps the furthest point each diagonal reaches. A difference is
+// resolved once some diagonal matches resync_bases in a row again (or reaches the end of
+// both helixes). Diagonals whose score drops more than x_drop below the best score seen are
+// abandoned, a point scores +1 for every base it has consumed and -edit_penalty per edit.
+//
+// The extension is unit cost by construction: keeping only the furthest point per diagonal and
+// edit count is only exact when a mismatch and a gap base cost the same, so it takes no
+// scoring policy. Weighted edits need a front per penalty instead, see wavefront_engine.
+class greedy_extension
+{
+    static constexpr int64_t unreached = std::numeric_limits<int64_t>::min() / 4;
+    static constexpr int64_t edit_penalty = 4;
+
+    struct point
+    {
+        int64_t x = unreached; // offset in helix 1 after sliding, helix 2 is at x + k
+        int64_t start = unreached; // x before sliding
+        edit_op op = edit_op::match; // the edit that led here
+    };
+
+    int64_t band_;
+    int64_t x_drop_;
+    int64_t max_edits_;
+    int64_t resync_;
+    std::vector<std::vector<point>> fronts_; // one per edit count, indexed by k + band
+
+public:
+    greedy_extension(int64_t band, int64_t x_drop, int64_t resync_bases)
+        : band_(band), x_drop_(x_drop), max_edits_(2 * band), resync_(resync_bases)
+    {}
+
+    // Resolves the difference at (i, j), appending the edits (and the matches that follow
+    // them) to transcript. Returns false if it could not be resolved within the band, the
+    // edit limit or the x-drop.
+    bool extend(const sequence_buffer<byte_span>& v1, int64_t i, const sequence_buffer<byte_span>& v2,
+            int64_t j, edit_transcript& transcript, int64_t& end1, int64_t& end2)
+    {
+        const int64_t n1 = static_cast<int64_t>(v1.size()) - i;
+        const int64_t n2 = static_cast<int64_t>(v2.size()) - j;
+        const int64_t width = 2 * band_ + 1;
+        int64_t best = 0;
+
+        fronts_.clear();
+        fronts_.emplace_back(width);
+        fronts_[0][band_].x = fronts_[0][band_].start = 0;
+
+        for (int64_t d = 1; d <= max_edits_; ++d)
+        {
+            const std::vector<point>& prev = fronts_[d - 1];
+            std::vector<point> front(width);
+            bool alive = false;
+
+            for (int64_t k = -std::min(d, band_); k <= std::min(d, band_); ++k)
+            {
+                point p;
+                auto consider = [&p](int64_t x, edit_op op)
+                {
+                    if (x > p.start)
+                    {
+                        p.start = x;
+                        p.op = op;
+                    }
+                };
+
+                if (prev[k + band_].x != unreached)
+                    consider(prev[k + band_].x + 1, edit_op::mismatch);
+                if (k > -band_ && prev[k - 1 + band_].x != unreached)
+                    consider(prev[k - 1 + band_].x, edit_op::gap_helix1);
+                if (k < band_ && prev[k + 1 + band_].x != unreached)
+                    consider(prev[k + 1 + band_].x + 1, edit_op::gap_helix2);
+
+                if (p.start == unreached)
+                    continue;
+
+                // Clamp edits that would run past the end of a helix.
+                int64_t x = p.start, y = p.start + k;
+                if (x > n1 || y > n2 || y < 0)
+                    continue;
+
+                int64_t run = match_run(v1, i + x, v2, j + y, std::min(n1 - x, n2 - y));
+                p.x = x + run;
+
+                int64_t score = (2 * p.x + k) - edit_penalty * d;
+                if (score < best - x_drop_)
+                    continue;
+                best = std::max(best, score);
+                front[k + band_] = p;
+                alive = true;
+
+                if (run >= resync_ || (p.x == n1 && p.x + k == n2))
+                {
+                    fronts_.push_back(std::move(front));
+                    trace(d, k, transcript);
+                    end1 = i + p.x;
+                    end2 = j + p.x + k;
+                    return true;
+                }
+            }
+
+            if (!alive)
+                return false;
+            fronts_.push_back(std::move(front));
+        }
+
+        return false;
+    }
+
+private:
+    void trace(int64_t d, int64_t k, edit_transcript& transcript) const
+    {
+        std::vector<edit_run> runs;
+        for (; d > 0; --d)
+        {
+            const point& p = fronts_[d][k + band_];
+            runs.push_back(edit_run{edit_op::match, p.x - p.start});
+            runs.push_back(edit_run{p.op, 1});
+            if (p.op == edit_op::gap_helix1)
+                --k;
+            else if (p.op == edit_op::gap_helix2)
+                ++k;
+        }
+
+        for (auto it = runs.rbegin(); it != runs.rend(); ++it)
+            transcript.push(it->op, it->length);
+    }
+};
+
+// Aligns near identical helixes in close to linear time. Exact matches are skipped a word at
+// a time and every difference is resolved by a greedy x-drop extension limited to band
+// diagonals. Differences the extension gives up on (long indels, diverged stretches) are
+// aligned by the exact engine, one window of fallback_window bases at a time.
+//
+// Only the fallback engine takes a scoring policy, differences resolved by the extension are
+// the ones with the fewest edits (see greedy_extension). Use wfa_aligner where every
+// difference has to be scored by a policy.
+template<HelixStream T>
+class xdrop_aligner : public sequence_aligner<T>
+{
+    const sequence_aligner<packed_stream>& fallback_;
+    int64_t band_;
+    int64_t x_drop_;
+    int64_t window_;
+
+    // Aligns a window starting at (i, j) with the exact engine and commits the mutations that
+    // end at least a quarter window before the end of the window (or all of them at the end
+    // of both helixes). Returns where alignment resumes.
+    void align_window(const helix_bases& s1, int64_t& i, const helix_bases& s2, int64_t& j,
+            std::vector<mutation>& muts) const
+    {
+        int64_t len1 = std::min<int64_t>(window_, s1.size() - i);
+        int64_t len2 = std::min<int64_t>(window_, s2.size() - j);
+        bool end1 = i + len1 == static_cast<int64_t>(s1.size());
+        bool end2 = j + len2 == static_cast<int64_t>(s2.size());
+
+        if (len1 == 0 || len2 == 0)
+        {
+            // one helix is done, the rest of the other is a gap
+            muts.emplace_back(location{i, len1}, location{j, len2});
+            i += len1;
+            j += len2;
+            return;
+        }
+
+        packed_stream h1(s1, i, len1), h2(s2, j, len2);
+        alignment_result res = fallback_.align(h1, h2);
+        if (!res.error.empty())
+            throw std::runtime_error(res.error);
+
+        int64_t limit1 = end1 ? len1 : len1 - window_ / 4;
+        int64_t limit2 = end2 ? len2 : len2 - window_ / 4;
+        std::size_t committed = 0;
+        int64_t cut1 = 0, cut2 = 0;
+        if (end1 && end2)
+        {
+            committed = res.mutations.size();
+            cut1 = len1;
+            cut2 = len2;
+        } else
+        {
+            for (std::size_t m = 0; m < res.mutations.size(); ++m)
+            {
+                const mutation& mut = res.mutations[m];
+                int64_t e1 = mut.helix1.offset + mut.helix1.length, e2 = mut.helix2.offset + mut.helix2.length;
+                if (e1 > limit1 || e2 > limit2)
+                    break;
+                committed = m + 1;
+                cut1 = e1;
+                cut2 = e2;
+            }
+
+            if (committed == 0)
+            {
+                // Nothing fits in the window, commit it whole to make progress.
+                committed = res.mutations.size();
+                cut1 = len1;
+                cut2 = len2;
+            }
+        }
+
+        for (std::size_t m = 0; m < committed; ++m)
+        {
+            const mutation& mut = res.mutations[m];
+            muts.emplace_back(location{mut.helix1.offset + i, mut.helix1.length},
+                    location{mut.helix2.offset + j, mut.helix2.length});
+        }
+        i += cut1;
+        j += cut2;
+    }
+
+public:
+    explicit xdrop_aligner(const sequence_aligner<packed_stream>& fallback, int64_t band = 32,
+            int64_t x_drop = 64, int64_t fallback_window = 1 << 12)
+        : fallback_(fallback), band_(band), x_drop_(x_drop), window_(std::max<int64_t>(fallback_window, 4 * word_bases))
+    {}
+
+    alignment_result align(T& a, T& b) const override
+    {
+        alignment_result res;
+        if (a.size() == 0 && b.size() == 0)
+        {
+            res.similarity_score = 1;
+            return res;
+        }
+
+        if (a.size() == 0 || b.size() == 0)
+        {
+            res.error = NoDataErr;
+            return res;
+        }
+
+        helix_bases s1 = read_helix(a);
+        helix_bases s2 = read_helix(b);
+        auto v1 = s1.view(), v2 = s2.view();
+        const int64_t n1 = s1.size(), n2 = s2.size();
+
+        greedy_extension extension(band_, x_drop_, word_bases);
+        int64_t i = 0, j = 0;
+        while (true)
+        {
+            int64_t run = match_run(v1, i, v2, j, std::min(n1 - i, n2 - j));
+            i += run;
+            j += run;
+            if (i == n1 && j == n2)
+                break;
+
+            edit_transcript transcript;
+            int64_t end1 = 0, end2 = 0;
+            if (extension.extend(v1, i, v2, j, transcript, end1, end2))
+            {
+                for (auto& mut : transcript.mutations(i, j))
+                    res.mutations.push_back(mut);
+                i = end1;
+                j = end2;
+            } else
+            {
+                align_window(s1, i, s2, j, res.mutations);
+            }
+        }
+
+        double total_muts = 0;
+        for (auto& mut : res.mutations)
+            total_muts += mut.helix1.length;
+        res.similarity_score = 1 - (total_muts / std::max(n1, n2));
+        return res;
+    }
+};
+
+} // dna